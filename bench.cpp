@@ -0,0 +1,149 @@
+/*******************************************************************************************************
+  Benchmark harness for the SHA-256 implementation.
+
+  Drives the individual pipeline stages (hex decode, streaming context, compression kernel,
+  multi-buffer engine) across a range of message sizes and reports MB/s and cycles/byte, so
+  a regression in any one stage is visible instead of hiding inside end-to-end numbers.
+
+  Build with "make bench". Pass --large to include the 1 GiB size, which needs the memory
+  and the patience for it.
+********************************************************************************************************/
+#define SHA256_NO_MAIN
+#include "sha256.cpp"
+
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+// Reads the CPU timestamp counter where one exists, 0 elsewhere (cycles/byte is then skipped)
+static unsigned long long readCycleCounter(){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    unsigned long long count;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(count));
+    return count;
+#else
+    return 0;
+#endif
+}
+
+static double nowSeconds(){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// One measurement: the median over repetitions, with the spread of the middle half of the
+// runs as a simple confidence interval
+struct Measurement {
+    double megabytesPerSecond;
+    double cyclesPerByte;
+    double spreadPercent;
+};
+
+// Runs work() repeatedly over bytes-per-call input and measures it. A warmup run gets the
+// caches, page tables and the frequency governor settled before anything is recorded.
+template <typename Work>
+static Measurement measure(unsigned long long bytesPerCall, Work work){
+    const int repetitions = 9;
+    work(); // warmup
+    double seconds[repetitions];
+    double cycles[repetitions];
+    for (int r = 0; r < repetitions; ++r){
+        double t0 = nowSeconds();
+        unsigned long long c0 = readCycleCounter();
+        work();
+        cycles[r] = (double)(readCycleCounter() - c0);
+        seconds[r] = nowSeconds() - t0;
+    }
+    std::sort(seconds, seconds + repetitions);
+    std::sort(cycles, cycles + repetitions);
+    Measurement m;
+    m.megabytesPerSecond = bytesPerCall / seconds[repetitions / 2] / 1e6;
+    m.cyclesPerByte = cycles[repetitions / 2] / bytesPerCall;
+    m.spreadPercent = 100.0 * (seconds[3 * repetitions / 4] - seconds[repetitions / 4]) / seconds[repetitions / 2];
+    return m;
+}
+
+static void printRow(const char *stage, unsigned long long size, const Measurement &m){
+    std::cout << std::left << std::setw(22) << stage
+              << std::right << std::setw(12) << size
+              << std::setw(12) << std::fixed << std::setprecision(1) << m.megabytesPerSecond
+              << std::setw(12) << std::setprecision(2) << m.cyclesPerByte
+              << std::setw(9) << std::setprecision(1) << m.spreadPercent << "%\n";
+}
+
+int main(int argc, char *argv[]){
+    bool large = argc > 1 && std::string(argv[1]) == "--large";
+
+    std::vector<unsigned long long> sizes = {64, 1024, 64 * 1024, 1024 * 1024};
+    if (large){
+        sizes.push_back(1024ull * 1024 * 1024);
+    }
+
+    std::cout << std::left << std::setw(22) << "stage"
+              << std::right << std::setw(12) << "bytes"
+              << std::setw(12) << "MB/s"
+              << std::setw(12) << "cycles/B"
+              << std::setw(10) << "spread\n";
+
+    for (unsigned long long size : sizes){
+        // A deterministic pseudo-random message so every run hashes the same bytes
+        std::vector<unsigned char> message(size);
+        unsigned int seed = 0x12345678;
+        for (unsigned long long i = 0; i < size; ++i){
+            seed = seed * 1664525 + 1013904223;
+            message[i] = seed >> 24;
+        }
+
+        // Stage: hex decode, the way stdin lines arrive
+        {
+            std::string hex(size * 2, '0');
+            static const char digits[] = "0123456789abcdef";
+            for (unsigned long long i = 0; i < size; ++i){
+                hex[i * 2] = digits[message[i] >> 4];
+                hex[i * 2 + 1] = digits[message[i] & 0xF];
+            }
+            std::vector<unsigned char> decoded;
+            Measurement m = measure(size, [&]{ decodeHex(hex, decoded); });
+            printRow("hex decode", size, m);
+        }
+
+        // Stage: the compression kernel alone, full blocks back to back
+        {
+            std::array<unsigned int, 8> state = {H0[0], H0[1], H0[2], H0[3], H0[4], H0[5], H0[6], H0[7]};
+            unsigned long long blocks = size / 64;
+            Measurement m = measure(blocks * 64, [&]{
+                for (unsigned long long b = 0; b < blocks; ++b){
+                    compressBlock(state, message.data() + b * 64);
+                }
+            });
+            printRow("compression kernel", size, m);
+        }
+
+        // Stage: the whole streaming context, including buffering and final padding
+        {
+            Sha256Context context;
+            Measurement m = measure(size, [&]{
+                context.init();
+                context.update(message.data(), size);
+                context.final();
+            });
+            printRow("streaming context", size, m);
+        }
+
+        // Stage: the multi-buffer engine, the batch as laneWidth slices of the message
+        if (size >= (unsigned long long)laneWidth){
+            unsigned long long slice = size / laneWidth;
+            std::vector<MessageView> views(laneWidth);
+            std::vector<std::array<unsigned int, 8>> digests(laneWidth);
+            for (int l = 0; l < laneWidth; ++l){
+                views[l] = {message.data() + l * slice, slice};
+            }
+            Measurement m = measure(slice * laneWidth, [&]{
+                sha256Many(views.data(), digests.data(), laneWidth);
+            });
+            printRow("multi-buffer engine", size, m);
+        }
+    }
+    return 0;
+}
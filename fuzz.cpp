@@ -0,0 +1,82 @@
+/*******************************************************************************************************
+  Fuzz target for the input and hashing layers.
+
+  Feeds arbitrary bytes through the validating hex decoder, the streaming context, the
+  multi-buffer engine and HMAC. Besides memory safety (the point of fuzzing the SIMD and
+  mmap-era fast paths), the target cross-checks the independent implementations against
+  each other, so it doubles as a differential oracle: chunked streaming must match
+  one-shot hashing, every lane of the multi-buffer engine must match the scalar context,
+  and a restored snapshot must pick up exactly where the original left off.
+
+  Build with "make fuzz" (needs clang for libFuzzer) and run "./fuzz corpus/".
+********************************************************************************************************/
+#define SHA256_NO_MAIN
+#include "sha256.cpp"
+
+extern "C" int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size){
+    // The hex decoder on the raw input, as a stdin line would arrive
+    std::string line((const char *)data, size);
+    std::vector<unsigned char> decoded;
+    decodeHex(line, decoded);
+
+    // Chunked streaming against one-shot, with a data-derived chunk size
+    unsigned long long chunk = size > 0 ? data[0] % 150 + 1 : 1;
+    Sha256Context streamed;
+    streamed.init();
+    for (unsigned long long offset = 0; offset < size; offset += chunk){
+        unsigned long long n = size - offset < chunk ? size - offset : chunk;
+        streamed.update(data + offset, n);
+    }
+    Sha256Context oneShot;
+    oneShot.init();
+    oneShot.update(data, size);
+    std::array<unsigned int, 8> expected = oneShot.final();
+    if (streamed.final() != expected){
+        __builtin_trap();
+    }
+
+    // A snapshot taken mid-message must resume to the same digest
+    unsigned long long cut = size / 2;
+    Sha256Context first;
+    first.init();
+    first.update(data, cut);
+    Sha256Snapshot snap = first.snapshot();
+    Sha256Context resumed;
+    resumed.init();
+    resumed.restore(snap);
+    resumed.update(data + cut, size - cut);
+    if (resumed.final() != expected){
+        __builtin_trap();
+    }
+
+    // The multi-buffer engine over uneven slices of the input, every lane checked
+    // against the scalar context
+    MessageView views[5];
+    std::array<unsigned int, 8> digests[5];
+    unsigned long long offset = 0;
+    for (int i = 0; i < 5; ++i){
+        unsigned long long n = (size - offset) / (5 - i);
+        views[i] = {data + offset, n};
+        offset += n;
+    }
+    sha256Many(views, digests, 5);
+    for (int i = 0; i < 5; ++i){
+        Sha256Context lane;
+        lane.init();
+        lane.update(views[i].data, views[i].length);
+        if (lane.final() != digests[i]){
+            __builtin_trap();
+        }
+    }
+
+    // HMAC with the front of the input as the key and the rest as the message
+    unsigned long long keyLength = size > 0 ? data[0] % 100 : 0;
+    if (keyLength > size){
+        keyLength = size;
+    }
+    HmacSha256 mac;
+    mac.setKey(data, keyLength);
+    mac.compute(data + keyLength, size - keyLength);
+
+    return 0;
+}
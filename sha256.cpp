@@ -8,12 +8,53 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <array>
 #include <iomanip>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <map>
+#include <atomic>
+#include <memory>
+#include <csignal>
+#include <new>
+
+#include <fstream>
+
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if __has_include(<liburing.h>)
+#include <liburing.h>
+#define SHA256_HAVE_URING 1
+#endif
+
+#if __has_include(<CL/cl.h>)
+#define CL_TARGET_OPENCL_VERSION 120
+#include <CL/cl.h>
+#define SHA256_HAVE_OPENCL 1
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
 
 /***********************************************************************************************************************************/
-// Constants used in hash algorithm. According to specification
-const unsigned int K[] = {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+// Constants used in hash algorithm. According to specification. Cache-line aligned:
+// every round of every block reads this table, so its four lines should never share
+// residency with anything else.
+alignas(64) constexpr unsigned int K[] = {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
                   0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
                   0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
                   0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
@@ -22,84 +63,323 @@ const unsigned int K[] = {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956
                   0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
                   0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
 
-// This is an empty array which is used as a template for the message schedule
-unsigned int W[64];
+// The initial hash value H0, according to specification
+constexpr unsigned int H0[] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                           0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
 
-// These are the working variables which are used by the algorithm
-unsigned int a, b, c, d, e, f, g, h, T1, T2;
 /**********************************************************************************************************************************/
 
-// Handles input. Reads string value and stores it inside a vector
-std::vector<unsigned char> readInput(const std::string &input){
-    std::vector<unsigned char> inputVector;
-    int size = input.length();
-    for (int i = 0, pos = 0; i < size / 2; ++i, pos += 2){
-        // gets characters from the string as a hexadecimal value in pairs of 2. Then stores the values in inputvector
-        unsigned char hexpair = std::stoi(input.substr(pos, 2), nullptr, 16);
-        inputVector.push_back(hexpair);
+/*
+ Self-profiling. Built with STATS=1 (-DSHA256_STATS) the hot paths maintain per-thread
+ counters - bytes hashed, blocks compressed, lines decoded, heap allocations - and
+ cycle-counter timings around the decode, compress and output stages. --stats dumps
+ everything as one JSON line to stderr on exit, and SIGUSR1 dumps a snapshot of the
+ totals at any point. In a normal build every probe compiles to nothing, so the
+ instrumented binary is the special case, not the shipping one.
+*/
+#ifdef SHA256_STATS
+
+// The same counter the benchmark harness reads; cheap enough to sit on stage boundaries
+inline unsigned long long statsCycles(){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    unsigned long long count;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(count));
+    return count;
+#else
+    return 0;
+#endif
+}
+
+// The global totals, folded into from each thread's local counters as it exits. Plain
+// relaxed atomics: the dump only needs a consistent-enough snapshot.
+struct StatsTotals {
+    std::atomic<unsigned long long> bytesHashed{0};
+    std::atomic<unsigned long long> blocksCompressed{0};
+    std::atomic<unsigned long long> linesDecoded{0};
+    std::atomic<unsigned long long> allocations{0};
+    std::atomic<unsigned long long> decodeCycles{0};
+    std::atomic<unsigned long long> compressCycles{0};
+    std::atomic<unsigned long long> outputCycles{0};
+};
+StatsTotals statsTotals;
+
+// One thread's counters, bumped without atomics on the hot path and folded into the
+// totals when the thread finishes
+struct StatsCounters {
+    unsigned long long bytesHashed = 0;
+    unsigned long long blocksCompressed = 0;
+    unsigned long long linesDecoded = 0;
+    unsigned long long allocations = 0;
+    unsigned long long decodeCycles = 0;
+    unsigned long long compressCycles = 0;
+    unsigned long long outputCycles = 0;
+
+    void fold(){
+        statsTotals.bytesHashed += bytesHashed;
+        statsTotals.blocksCompressed += blocksCompressed;
+        statsTotals.linesDecoded += linesDecoded;
+        statsTotals.allocations += allocations;
+        statsTotals.decodeCycles += decodeCycles;
+        statsTotals.compressCycles += compressCycles;
+        statsTotals.outputCycles += outputCycles;
+        // Zeroed field by field; a temporary StatsCounters here would fold() again
+        // from its own destructor
+        bytesHashed = blocksCompressed = linesDecoded = allocations = 0;
+        decodeCycles = compressCycles = outputCycles = 0;
+    }
+
+    ~StatsCounters(){
+        fold();
+    }
+};
+thread_local StatsCounters statsCounters;
+
+// Counts every heap allocation while the instrumented build runs
+void *operator new(size_t size){
+    ++statsCounters.allocations;
+    void *memory = malloc(size);
+    if (memory == nullptr){
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+void operator delete(void *memory) noexcept { free(memory); }
+void operator delete(void *memory, size_t) noexcept { free(memory); }
+
+// Times one stage for the duration of a scope
+struct StatsScope {
+    unsigned long long &sink;
+    unsigned long long start;
+    StatsScope(unsigned long long &sink) : sink(sink), start(statsCycles()){}
+    ~StatsScope(){ sink += statsCycles() - start; }
+};
+
+#define STATS_ADD(field, amount) (statsCounters.field += (amount))
+#define STATS_SCOPE(field) StatsScope statsScope##field(statsCounters.field)
+// Folded once per batch, so a SIGUSR1 snapshot is at most one batch behind
+#define STATS_FOLD() statsCounters.fold()
+
+// Formats and writes the JSON line with nothing but write(2) and stack buffers, so the
+// SIGUSR1 handler can share it safely
+void statsDump(){
+    char line[512];
+    int pos = 0;
+    const char *names[] = {"bytesHashed", "blocksCompressed", "linesDecoded", "allocations",
+                           "decodeCycles", "compressCycles", "outputCycles"};
+    unsigned long long values[] = {statsTotals.bytesHashed, statsTotals.blocksCompressed,
+                                   statsTotals.linesDecoded, statsTotals.allocations,
+                                   statsTotals.decodeCycles, statsTotals.compressCycles,
+                                   statsTotals.outputCycles};
+    line[pos++] = '{';
+    for (int i = 0; i < 7; ++i){
+        if (i > 0){
+            line[pos++] = ',';
+        }
+        line[pos++] = '"';
+        for (const char *c = names[i]; *c; ++c){
+            line[pos++] = *c;
+        }
+        line[pos++] = '"';
+        line[pos++] = ':';
+        char digits[24];
+        int n = 0;
+        unsigned long long v = values[i];
+        do {
+            digits[n++] = '0' + v % 10;
+            v /= 10;
+        } while (v > 0);
+        while (n > 0){
+            line[pos++] = digits[--n];
+        }
     }
-    return inputVector;
+    line[pos++] = '}';
+    line[pos++] = '\n';
+    write(2, line, pos);
+}
+
+void statsSignalHandler(int){
+    statsDump();
 }
 
-// Prints the hash value
-void printHash(std::vector<std::vector<unsigned int>> H, int N){
-    for (int i = 0; i < 8; i++){
-        std::cout << std::hex << std::setw(8) << std::setfill('0') << H[N][i];
+#else
+
+#define STATS_ADD(field, amount)
+#define STATS_SCOPE(field)
+#define STATS_FOLD()
+
+#endif // SHA256_STATS
+
+// Set by --stats; in a build without SHA256_STATS the flag only triggers a warning
+bool statsEnabled = false;
+
+// The value of every ASCII character as a hex digit, 0xFF for characters that are not hex digits
+struct HexTable {
+    unsigned char value[256];
+    HexTable(){
+        memset(value, 0xFF, sizeof(value));
+        for (int i = 0; i < 10; ++i){
+            value['0' + i] = i;
+        }
+        for (int i = 0; i < 6; ++i){
+            value['a' + i] = 10 + i;
+            value['A' + i] = 10 + i;
+        }
+    }
+};
+const HexTable hexTable;
+
+// Decodes a line of hex pairs into out. Table lookups instead of per-byte string
+// temporaries, and one pass over the whole line. Returns false if the line has an odd
+// number of characters or contains a non-hex character; out is unspecified in that case.
+bool decodeHex(std::string_view input, unsigned char *out){
+    if (input.length() % 2 != 0){
+        return false;
+    }
+    // Invalid characters map to 0xFF, so accumulating ORs lets the loop stay branch-free
+    // and one check at the end catch any bad character
+    unsigned int bad = 0;
+    for (unsigned long long i = 0; i < input.length() / 2; ++i){
+        unsigned int high = hexTable.value[(unsigned char)input[i * 2]];
+        unsigned int low = hexTable.value[(unsigned char)input[i * 2 + 1]];
+        bad |= high | low;
+        out[i] = (high << 4) | low;
     }
-    std::cout << "\n";
+    return bad <= 0xF;
 }
 
-// Heturns the amount of bits of padding is required. Used by paddingMessage. Implemented as in section 5.1.1.
-const int getPadding(long long length){
-    int k = 0;
-    while ((length + 1 + k) % 512 != 448){
-        ++k;
+bool decodeHex(std::string_view input, std::vector<unsigned char> &out){
+    if (input.length() % 2 != 0){
+        return false;
     }
-    return k;
+    out.resize(input.length() / 2);
+    return decodeHex(input, out.data());
 }
 
-// Pads the message contents according to section 5.1.
-std::vector<unsigned char> paddingMessage(std::vector<unsigned char> M){
-    // obtains the amount "k" bits which needs to be padded to the message
-    int k = getPadding(M.size()*8);
-    long long l = (M.size()*8);
-    // Append a 1 before the least significant bit in the message
-    M.push_back(0x80);
-    k = k - 7;
-    // Append the remaining zeroes of k
-    for (int i = 0; i < (k / 8); ++i){
-        M.push_back(0);
+// Parses a small decimal value with explicit bounds, rejecting garbage via the return
+// code instead of the exception std::stoi would throw. Used for command line numbers,
+// so the limit only has to cover sane values of those.
+bool parseSmallInt(const char *text, int &out){
+    if (text == nullptr || *text == '\0'){
+        return false;
     }
-    // Append the length (l) as 0's to the message
-    for (int i = 1; i < 9; ++i){
-        M.push_back(l >> (64 - i * 8));
+    long long value = 0;
+    for (const char *p = text; *p != '\0'; ++p){
+        if (*p < '0' || *p > '9'){
+            return false;
+        }
+        value = value * 10 + (*p - '0');
+        if (value > 1 << 20){
+            return false;
+        }
     }
-    // return the now padded message.
-    return M;
+    out = (int)value;
+    return true;
 }
 
-// Parse the message into n 512-bit blocks
-std::vector<std::vector<unsigned int>> parsingMessage(std::vector<unsigned char> bytes){
-    // Create a 2d vector for storing all the blocks, in total we will obtain 16 32-bit blocks (16 * 32 = 512)
-    std::vector<std::vector<unsigned int>> M;
-    unsigned int n = 0;
-    for (int i = 0; n < bytes.size() / 64; ++n){
-        // Create a new block, since we handle our bits in pairs, 16 indices is enough for a 32-bit block
-        std::vector<unsigned int> block(16);
-        for (int j = 0; j < 16; ++j){
-            unsigned int word = 0;
-            for (int k = 0; k < 4; ++k, ++i){
-                word <<= 8;
-                word |= bytes[i];
+// The two-character hex expansion of every byte value, so digests format by table lookup
+struct HexPairTable {
+    char text[256][2];
+    HexPairTable(){
+        const char digits[] = "0123456789abcdef";
+        for (int i = 0; i < 256; ++i){
+            text[i][0] = digits[i >> 4];
+            text[i][1] = digits[i & 0xF];
+        }
+    }
+};
+const HexPairTable hexPairs;
+
+/*
+ Batched digest output. Formatting every digest through eight iostream manipulator
+ sequences costs more than hashing a short line does, so digests are formatted into a
+ 64-character line by table lookup and appended to one large buffer that is flushed
+ with a single write(2) once it fills up (and once more at exit).
+*/
+class DigestWriter {
+public:
+    DigestWriter(){
+        buffer.reserve(flushThreshold + 80);
+    }
+
+    ~DigestWriter(){
+        flush();
+    }
+
+    void writeDigest(const std::array<unsigned int, 8> &digest){
+        char line[65];
+        int pos = 0;
+        for (int i = 0; i < 8; ++i){
+            for (int shift = 24; shift >= 0; shift -= 8){
+                const char *pair = hexPairs.text[(digest[i] >> shift) & 0xFF];
+                line[pos++] = pair[0];
+                line[pos++] = pair[1];
+            }
+        }
+        line[64] = '\n';
+        buffer.append(line, 65);
+        if (buffer.size() >= flushThreshold){
+            flush();
+        }
+    }
+
+    // Digests of the other family members arrive as bytes of varying width
+    void writeDigestBytes(const unsigned char *digest, int count){
+        for (int i = 0; i < count; ++i){
+            buffer.append(hexPairs.text[digest[i]], 2);
+        }
+        buffer.push_back('\n');
+        if (buffer.size() >= flushThreshold){
+            flush();
+        }
+    }
+
+    // The manifest form used by the batch file modes: digest, two spaces, path
+    void writeDigestWithPath(const std::array<unsigned int, 8> &digest, const std::string &path){
+        char line[66];
+        int pos = 0;
+        for (int i = 0; i < 8; ++i){
+            for (int shift = 24; shift >= 0; shift -= 8){
+                const char *pair = hexPairs.text[(digest[i] >> shift) & 0xFF];
+                line[pos++] = pair[0];
+                line[pos++] = pair[1];
             }
-            // insert our created word at the current index in our current block
-            block[j] = word;
         }
-        // insert the finished block in our 2d vector
-        M.push_back(block);
+        line[64] = ' ';
+        line[65] = ' ';
+        buffer.append(line, 66);
+        buffer.append(path);
+        buffer.push_back('\n');
+        if (buffer.size() >= flushThreshold){
+            flush();
+        }
+    }
+
+    void flush(){
+        STATS_SCOPE(outputCycles);
+        const char *data = buffer.data();
+        unsigned long long remaining = buffer.size();
+        while (remaining > 0){
+            long long written = write(1, data, remaining);
+            if (written <= 0){
+                break;
+            }
+            data += written;
+            remaining -= written;
+        }
+        buffer.clear();
     }
-    // return the parsed message
-    return M;
+
+private:
+    static const unsigned long long flushThreshold = 1 << 20;
+    std::string buffer;
+};
+DigestWriter digestWriter;
+
+// Prints a digest through the batched writer
+void printHash(const std::array<unsigned int, 8> &digest){
+    digestWriter.writeDigest(digest);
 }
 
 /*
@@ -107,147 +387,2795 @@ std::vector<std::vector<unsigned int>> parsingMessage(std::vector<unsigned char>
  They are called upon by the compute hash function
 */
 // Right shift function, implemented as presented in section 3.2.
-const unsigned int SHR(const unsigned int &n, const unsigned int &x)
+constexpr unsigned int SHR(unsigned int n, unsigned int x)
 {
     return x >> n;
 }
 
 // Rotate right (circular right shift), implemented as presented in section 3.2. Our blocks never exceed a size of 32 bits. Therefore w is set as a constant.
-const unsigned int ROTR(const unsigned int &n, const unsigned int &x)
+constexpr unsigned int ROTR(unsigned int n, unsigned int x)
 {
     return (x >> n) | (x << (32 - n));
 }
 
 // The Ch function used by the hash algorithm. Implemented as presented in section 4.1.2.
-const unsigned int Ch(const unsigned int &x, const unsigned int &y, const unsigned in
-        for (int j = 0; j < 16; ++j){
-            unsigned int word = 0;
-            for (int k = 0; k < 4; ++k, ++i){
-                word <<= 8;
-                word |= bytes[i];
-            }
-            // insert our created word at the current index in our current block
-            block[j] = word;
-        }
-        // insert the finished block in our t &z)
+constexpr unsigned int Ch(unsigned int x, unsigned int y, unsigned int z)
 {
     return (x & y) ^ (~x & z);
 }
 
 // The Maj function used by the hash algorithm. Implemented as presented in section 4.1.2.
-const unsigned int Maj(const unsigned int &x, const unsigned int &y, const unsigned int &z)
+constexpr unsigned int Maj(unsigned int x, unsigned int y, unsigned int z)
 {
     return (x & y) ^ (x & z) ^ (y & z);
 }
 
 // These functions depend on SHR and ROTR
 // Capital sigma function 0 used by the hash algorithm. Implemented as presented in section 4.1.2.
-const unsigned int capitalSigma_0(const unsigned int &x)
+constexpr unsigned int capitalSigma_0(unsigned int x)
 {
     return ROTR(2, x) ^ ROTR(13, x) ^ ROTR(22, x);
 }
 
 // Capital sigma function 1 used by the hash algorithm. Implemented as presented in section 4.1.2.
-const unsigned int capitalSigma_1(const unsigned int &x)
+constexpr unsigned int capitalSigma_1(unsigned int x)
 {
     return ROTR(6, x) ^ ROTR(11, x) ^ ROTR(25, x);
 }
 
 // Lowercase sigma function 0 used by the hash algorithm. Implemented as presented in section 4.1.2.
-const unsigned int lowercaseSigma0(const unsigned int &x)
+constexpr unsigned int lowercaseSigma0(unsigned int x)
 {
     return ROTR(7, x) ^ ROTR(18, x) ^ SHR(3, x);
 }
 
 // Lowercase sigma function 1 used by the hash algorithm. Implemented as presented in section 4.1.2.
-const unsigned int lowercaseSigma1(const unsigned int &x)
+constexpr unsigned int lowercaseSigma1(unsigned int x)
 {
     return ROTR(17, x) ^ ROTR(19, x) ^ SHR(10, x);
 }
 
-// Computes the hash value. Using the steps specified in section 6.2.2 the specification
-std::vector<std::vector<unsigned int>> getHash(std::vector<std::vector<unsigned int>> M){
-    // sets the initial hash value H0, according to specification
-    std::vector<std::vector<unsigned int>> Hash;
-    std::vector<unsigned int> H0 = {0x6a09e667,
-                           0xbb67ae85,
-                           0x3c6ef372,
-                           0xa54ff53a,
-                           0x510e527f,
-                           0x9b05688c,
-                           0x1f83d9ab,
-                           0x5be0cd19};
-    Hash.push_back(H0);
-
-    // Creates a new block
-    std::vector<unsigned int> currentBlock(8);
-    int N = M.size();
-    // we compute the hash, using the previous hash values, for all blocks 1 to N
-    for (int i = 1; i <= N; ++i)
-    {
-        // The two different methods used for the message schedule, depending on the size of t.
-        for (int t = 0; t <= 15; ++t)
-            W[t] = M[i - 1][t]; // M^i in spec
-        for (int t = 16; t <= 63; ++t)
-            W[t] = lowercaseSigma1(W[t - 2]) + W[t - 7] + lowercaseSigma0(W[t - 15]) + W[t - 16];
-
-        // We set the values of our working variables dependent of the values of the previous hash. Hence why we got to use an initial hash.
-        a = Hash[i - 1][0];
-        b = Hash[i - 1][1];
-        c = Hash[i - 1][2];
-        d = Hash[i - 1][3];
-        e = Hash[i - 1][4];
-        f = Hash[i - 1][5];
-        g = Hash[i - 1][6];
-        h = Hash[i - 1][7];
-
-        // Logical operations performed as specififed in seection 6.2.2.
-        for (int t = 0; t <= 63; ++t)
-        {
-            T1 = h + capitalSigma_1(e) + Ch(e, f, g) + K[t] + W[t];
-            T2 = capitalSigma_0(a) + Maj(a, b, c);
-            h = g;
-            g = f;
-            f = e;
-            e = d + T1;
-            d = c;
-            c = b;
-            b = a;
-            a = T1 + T2;
+// Loads one 32-bit word from an arbitrarily aligned pointer, most significant byte first
+// as section 5.2 numbers them. Compiles to a single load plus byte swap, so the kernels
+// read their words straight out of the raw input buffer.
+inline unsigned int loadBigEndian32(const unsigned char *p){
+    unsigned int word;
+    memcpy(&word, p, 4);
+    return __builtin_bswap32(word);
+}
+
+/*
+ Compression kernels. The compression function (section 6.2.2) is the hot loop of
+ the whole algorithm, so besides the portable scalar version there are kernels
+ using the SHA extensions on x86 (sha256rnds2 and friends) and on ARMv8
+ (vsha256hq/vsha256h2q). Which one to use is decided once at startup, the scalar
+ loop is always available as a fallback.
+*/
+
+// One schedule word for round t >= 16, computed in place in a rolling 16-word window:
+// W[t] only ever depends on the previous 16 words, so the full 64-entry array is never needed
+constexpr unsigned int scheduleNext(unsigned int W[16], int t){
+    W[t & 15] = lowercaseSigma1(W[(t - 2) & 15]) + W[(t - 7) & 15] +
+                lowercaseSigma0(W[(t - 15) & 15]) + W[(t - 16) & 15];
+    return W[t & 15];
+}
+
+/*
+ The round ladder of section 6.2.2 over one block, given the first 16 schedule words.
+ The rounds are unrolled eight at a time with the working variables renamed from round
+ to round, so the eight register-to-register moves of the rolling ladder disappear:
+ writing d += T1 and h = T1 + T2 here is exactly new-e and new-a once the names rotate.
+ constexpr so the compile-time path shares this code and the two can never drift.
+*/
+#define SHA256_ROUND(A, B, C, D, E, F, G, H, t, w) { \
+    unsigned int T1 = H + capitalSigma_1(E) + Ch(E, F, G) + K[t] + (w); \
+    unsigned int T2 = capitalSigma_0(A) + Maj(A, B, C); \
+    D += T1; \
+    H = T1 + T2; }
+
+#define SHA256_EIGHT_ROUNDS(t, w0, w1, w2, w3, w4, w5, w6, w7) \
+    SHA256_ROUND(a, b, c, d, e, f, g, h, (t) + 0, w0) \
+    SHA256_ROUND(h, a, b, c, d, e, f, g, (t) + 1, w1) \
+    SHA256_ROUND(g, h, a, b, c, d, e, f, (t) + 2, w2) \
+    SHA256_ROUND(f, g, h, a, b, c, d, e, (t) + 3, w3) \
+    SHA256_ROUND(e, f, g, h, a, b, c, d, (t) + 4, w4) \
+    SHA256_ROUND(d, e, f, g, h, a, b, c, (t) + 5, w5) \
+    SHA256_ROUND(c, d, e, f, g, h, a, b, (t) + 6, w6) \
+    SHA256_ROUND(b, c, d, e, f, g, h, a, (t) + 7, w7)
+
+constexpr void compressRounds(std::array<unsigned int, 8> &state, unsigned int W[16]){
+    // We set the values of our working variables dependent of the values of the previous hash.
+    unsigned int a = state[0], b = state[1], c = state[2], d = state[3];
+    unsigned int e = state[4], f = state[5], g = state[6], h = state[7];
+
+    // The first 16 rounds consume the words of the block as loaded
+    SHA256_EIGHT_ROUNDS(0, W[0], W[1], W[2], W[3], W[4], W[5], W[6], W[7])
+    SHA256_EIGHT_ROUNDS(8, W[8], W[9], W[10], W[11], W[12], W[13], W[14], W[15])
+
+    // The remaining 48 interleave the schedule extension with the rounds, so the
+    // schedule never exists beyond its 16-word window
+    for (int t = 16; t <= 63; t += 8){
+        SHA256_EIGHT_ROUNDS(t,
+            scheduleNext(W, t + 0), scheduleNext(W, t + 1),
+            scheduleNext(W, t + 2), scheduleNext(W, t + 3),
+            scheduleNext(W, t + 4), scheduleNext(W, t + 5),
+            scheduleNext(W, t + 6), scheduleNext(W, t + 7))
+    }
+
+    // We then compute the intermediate hash values, in place
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+#undef SHA256_EIGHT_ROUNDS
+#undef SHA256_ROUND
+
+// Compresses one 512-bit block into the running state with plain integer arithmetic.
+// The message schedule and working variables live on the stack, so the kernel is reentrant.
+void compressBlockScalar(std::array<unsigned int, 8> &state, const unsigned char *block){
+    unsigned int W[16] = {};
+    for (int t = 0; t <= 15; ++t)
+        W[t] = loadBigEndian32(block + t * 4);
+    compressRounds(state, W);
+}
+
+/*
+ Dual-stream kernel. Each round's T1 chains into the next round, so a single scalar
+ stream leaves most ALU ports idle waiting on that dependency. Interleaving the rounds
+ of two independent messages in one instruction stream gives the scheduler a second
+ chain to fill the gaps with - worth well over a full core's worth of throughput on
+ machines without SHA extensions. With SHA extensions the single-stream kernel already
+ saturates the unit, so this variant is only picked when they are absent.
+*/
+void compressBlockDual(std::array<unsigned int, 8> &stateA, const unsigned char *blockA,
+                       std::array<unsigned int, 8> &stateB, const unsigned char *blockB){
+    unsigned int WA[16], WB[16];
+    for (int t = 0; t <= 15; ++t){
+        WA[t] = loadBigEndian32(blockA + t * 4);
+        WB[t] = loadBigEndian32(blockB + t * 4);
+    }
+    unsigned int aA = stateA[0], bA = stateA[1], cA = stateA[2], dA = stateA[3];
+    unsigned int eA = stateA[4], fA = stateA[5], gA = stateA[6], hA = stateA[7];
+    unsigned int aB = stateB[0], bB = stateB[1], cB = stateB[2], dB = stateB[3];
+    unsigned int eB = stateB[4], fB = stateB[5], gB = stateB[6], hB = stateB[7];
+    for (int t = 0; t <= 63; ++t){
+        unsigned int wA = t < 16 ? WA[t] : scheduleNext(WA, t);
+        unsigned int wB = t < 16 ? WB[t] : scheduleNext(WB, t);
+        // Round t of both streams back to back; the two T1 chains are independent
+        unsigned int T1A = hA + capitalSigma_1(eA) + Ch(eA, fA, gA) + K[t] + wA;
+        unsigned int T1B = hB + capitalSigma_1(eB) + Ch(eB, fB, gB) + K[t] + wB;
+        unsigned int T2A = capitalSigma_0(aA) + Maj(aA, bA, cA);
+        unsigned int T2B = capitalSigma_0(aB) + Maj(aB, bB, cB);
+        hA = gA; gA = fA; fA = eA; eA = dA + T1A; dA = cA; cA = bA; bA = aA; aA = T1A + T2A;
+        hB = gB; gB = fB; fB = eB; eB = dB + T1B; dB = cB; cB = bB; bB = aB; aB = T1B + T2B;
+    }
+    stateA[0] += aA; stateA[1] += bA; stateA[2] += cA; stateA[3] += dA;
+    stateA[4] += eA; stateA[5] += fA; stateA[6] += gA; stateA[7] += hA;
+    stateB[0] += aB; stateB[1] += bB; stateB[2] += cB; stateB[3] += dB;
+    stateB[4] += eB; stateB[5] += fB; stateB[6] += gB; stateB[7] += hB;
+}
+
+/*
+ Compile-time evaluation. Everything the algorithm does is integer arithmetic, so digests
+ of string constants can be computed entirely by the compiler: embedding the expected hash
+ of a config blob costs nothing at startup or runtime. The loads are done bytewise here
+ because memcpy is not constexpr; the rounds are the shared compressRounds above.
+*/
+constexpr std::array<unsigned int, 8> sha256AtCompileTime(const char *data, unsigned long long length){
+    std::array<unsigned int, 8> state = {H0[0], H0[1], H0[2], H0[3], H0[4], H0[5], H0[6], H0[7]};
+    unsigned int W[16] = {};
+
+    // All complete blocks of the message
+    unsigned long long offset = 0;
+    for (; length - offset >= 64; offset += 64){
+        for (int t = 0; t <= 15; ++t){
+            W[t] = ((unsigned char)data[offset + t * 4] << 24) |
+                   ((unsigned char)data[offset + t * 4 + 1] << 16) |
+                   ((unsigned char)data[offset + t * 4 + 2] << 8) |
+                   (unsigned char)data[offset + t * 4 + 3];
         }
+        compressRounds(state, W);
+    }
 
-        // We then compute the intermediate hash values
-        currentBlock[0] = a + Hash[i - 1][0];
-        currentBlock[1] = b + Hash[i - 1][1];
-        currentBlock[2] = c + Hash[i - 1][2];
-        currentBlock[3] = d + Hash[i - 1][3];
-        currentBlock[4] = e + Hash[i - 1][4];
-        currentBlock[5] = f + Hash[i - 1][5];
-        currentBlock[6] = g + Hash[i - 1][6];
-        currentBlock[7] = h + Hash[i - 1][7];
-        // push our currentblock to Hash and move on to the next block
-        Hash.push_back(currentBlock);
+    // The padded tail, at most two blocks, built exactly as Sha256Context::final does
+    unsigned char tail[128] = {};
+    unsigned long long tailLength = length - offset;
+    for (unsigned long long i = 0; i < tailLength; ++i){
+        tail[i] = (unsigned char)data[offset + i];
+    }
+    tail[tailLength] = 0x80;
+    int tailBlocks = tailLength >= 56 ? 2 : 1;
+    unsigned long long l = length * 8;
+    for (int i = 0; i < 8; ++i){
+        tail[tailBlocks * 64 - 8 + i] = (unsigned char)(l >> (56 - i * 8));
+    }
+    for (int b = 0; b < tailBlocks; ++b){
+        for (int t = 0; t <= 15; ++t){
+            W[t] = (tail[b * 64 + t * 4] << 24) | (tail[b * 64 + t * 4 + 1] << 16) |
+                   (tail[b * 64 + t * 4 + 2] << 8) | tail[b * 64 + t * 4 + 3];
+        }
+        compressRounds(state, W);
     }
-    // return the hash
-    return Hash;
+    return state;
+}
+
+// Digest-of-a-string-literal suffix: "abc"_sha256 is a constant std::array<unsigned int, 8>
+constexpr std::array<unsigned int, 8> operator""_sha256(const char *data, std::size_t length){
+    return sha256AtCompileTime(data, length);
 }
 
+// Compile-time self-test against the FIPS 180-2 appendix B.1 example
+static_assert(("abc"_sha256)[0] == 0xba7816bf && ("abc"_sha256)[7] == 0xf20015ad,
+              "compile-time SHA-256 disagrees with the FIPS 180-2 test vector");
+
+#if defined(__x86_64__) || defined(__i386__)
+// Compresses one 512-bit block using the x86 SHA extensions. sha256rnds2 performs two
+// rounds per instruction on a (ABEF, CDGH) register pair, sha256msg1/sha256msg2 compute
+// the message schedule, so the 64-round ladder collapses into 32 round instructions.
+__attribute__((target("sha,sse4.1")))
+void compressBlockShaNi(std::array<unsigned int, 8> &state, const unsigned char *block){
+    __m128i STATE0, STATE1, MSG, TMP, MSG0, MSG1, MSG2, MSG3, ABEF_SAVE, CDGH_SAVE;
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // Load the running state and rearrange it into the (ABEF, CDGH) order the instructions expect
+    TMP = _mm_loadu_si128((const __m128i *)&state[0]);
+    STATE1 = _mm_loadu_si128((const __m128i *)&state[4]);
+    TMP = _mm_shuffle_epi32(TMP, 0xB1);          // CDAB
+    STATE1 = _mm_shuffle_epi32(STATE1, 0x1B);    // EFGH
+    STATE0 = _mm_alignr_epi8(TMP, STATE1, 8);    // ABEF
+    STATE1 = _mm_blend_epi16(STATE1, TMP, 0xF0); // CDGH
+
+    ABEF_SAVE = STATE0;
+    CDGH_SAVE = STATE1;
+
+    // Rounds 0-3
+    MSG = _mm_loadu_si128((const __m128i *)(block + 0));
+    MSG0 = _mm_shuffle_epi8(MSG, MASK);
+    MSG = _mm_add_epi32(MSG0, _mm_set_epi64x(0xE9B5DBA5B5C0FBCFULL, 0x71374491428A2F98ULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+
+    // Rounds 4-7
+    MSG1 = _mm_loadu_si128((const __m128i *)(block + 16));
+    MSG1 = _mm_shuffle_epi8(MSG1, MASK);
+    MSG = _mm_add_epi32(MSG1, _mm_set_epi64x(0xAB1C5ED5923F82A4ULL, 0x59F111F13956C25BULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+    MSG0 = _mm_sha256msg1_epu32(MSG0, MSG1);
 
-int main(){
-    // Read each line from standard input
-    for (std::string input; std::getline(std::cin, input);) {
+    // Rounds 8-11
+    MSG2 = _mm_loadu_si128((const __m128i *)(block + 32));
+    MSG2 = _mm_shuffle_epi8(MSG2, MASK);
+    MSG = _mm_add_epi32(MSG2, _mm_set_epi64x(0x550C7DC3243185BEULL, 0x12835B01D807AA98ULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+    MSG1 = _mm_sha256msg1_epu32(MSG1, MSG2);
 
-        // Read the input
-        std::vector<unsigned char> message = readInput(input);
+    // Rounds 12-15
+    MSG3 = _mm_loadu_si128((const __m128i *)(block + 48));
+    MSG3 = _mm_shuffle_epi8(MSG3, MASK);
+    MSG = _mm_add_epi32(MSG3, _mm_set_epi64x(0xC19BF1749BDC06A7ULL, 0x80DEB1FE72BE5D74ULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    TMP = _mm_alignr_epi8(MSG3, MSG2, 4);
+    MSG0 = _mm_add_epi32(MSG0, TMP);
+    MSG0 = _mm_sha256msg2_epu32(MSG0, MSG3);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+    MSG2 = _mm_sha256msg1_epu32(MSG2, MSG3);
 
-        // Padding
-        message = paddingMessage(message);
+    // Rounds 16-19
+    MSG = _mm_add_epi32(MSG0, _mm_set_epi64x(0x240CA1CC0FC19DC6ULL, 0xEFBE4786E49B69C1ULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    TMP = _mm_alignr_epi8(MSG0, MSG3, 4);
+    MSG1 = _mm_add_epi32(MSG1, TMP);
+    MSG1 = _mm_sha256msg2_epu32(MSG1, MSG0);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+    MSG3 = _mm_sha256msg1_epu32(MSG3, MSG0);
 
-        // Parse the message into n blocks
-        std::vector<std::vector<unsigned int>> parsed_message = parsingMessage(message);
+    // Rounds 20-23
+    MSG = _mm_add_epi32(MSG1, _mm_set_epi64x(0x76F988DA5CB0A9DCULL, 0x4A7484AA2DE92C6FULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    TMP = _mm_alignr_epi8(MSG1, MSG0, 4);
+    MSG2 = _mm_add_epi32(MSG2, TMP);
+    MSG2 = _mm_sha256msg2_epu32(MSG2, MSG1);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+    MSG0 = _mm_sha256msg1_epu32(MSG0, MSG1);
 
-        // Computes the hashvalue generated by the algorithm and prints it using stdout
-        printHash(getHash(parsed_message), parsed_message.size());
+    // Rounds 24-27
+    MSG = _mm_add_epi32(MSG2, _mm_set_epi64x(0xBF597FC7B00327C8ULL, 0xA831C66D983E5152ULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    TMP = _mm_alignr_epi8(MSG2, MSG1, 4);
+    MSG3 = _mm_add_epi32(MSG3, TMP);
+    MSG3 = _mm_sha256msg2_epu32(MSG3, MSG2);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+    MSG1 = _mm_sha256msg1_epu32(MSG1, MSG2);
+
+    // Rounds 28-31
+    MSG = _mm_add_epi32(MSG3, _mm_set_epi64x(0x1429296706CA6351ULL, 0xD5A79147C6E00BF3ULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    TMP = _mm_alignr_epi8(MSG3, MSG2, 4);
+    MSG0 = _mm_add_epi32(MSG0, TMP);
+    MSG0 = _mm_sha256msg2_epu32(MSG0, MSG3);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+    MSG2 = _mm_sha256msg1_epu32(MSG2, MSG3);
+
+    // Rounds 32-35
+    MSG = _mm_add_epi32(MSG0, _mm_set_epi64x(0x53380D134D2C6DFCULL, 0x2E1B213827B70A85ULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    TMP = _mm_alignr_epi8(MSG0, MSG3, 4);
+    MSG1 = _mm_add_epi32(MSG1, TMP);
+    MSG1 = _mm_sha256msg2_epu32(MSG1, MSG0);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+    MSG3 = _mm_sha256msg1_epu32(MSG3, MSG0);
+
+    // Rounds 36-39
+    MSG = _mm_add_epi32(MSG1, _mm_set_epi64x(0x92722C8581C2C92EULL, 0x766A0ABB650A7354ULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    TMP = _mm_alignr_epi8(MSG1, MSG0, 4);
+    MSG2 = _mm_add_epi32(MSG2, TMP);
+    MSG2 = _mm_sha256msg2_epu32(MSG2, MSG1);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+    MSG0 = _mm_sha256msg1_epu32(MSG0, MSG1);
+
+    // Rounds 40-43
+    MSG = _mm_add_epi32(MSG2, _mm_set_epi64x(0xC76C51A3C24B8B70ULL, 0xA81A664BA2BFE8A1ULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    TMP = _mm_alignr_epi8(MSG2, MSG1, 4);
+    MSG3 = _mm_add_epi32(MSG3, TMP);
+    MSG3 = _mm_sha256msg2_epu32(MSG3, MSG2);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+    MSG1 = _mm_sha256msg1_epu32(MSG1, MSG2);
+
+    // Rounds 44-47
+    MSG = _mm_add_epi32(MSG3, _mm_set_epi64x(0x106AA070F40E3585ULL, 0xD6990624D192E819ULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    TMP = _mm_alignr_epi8(MSG3, MSG2, 4);
+    MSG0 = _mm_add_epi32(MSG0, TMP);
+    MSG0 = _mm_sha256msg2_epu32(MSG0, MSG3);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+    MSG2 = _mm_sha256msg1_epu32(MSG2, MSG3);
+
+    // Rounds 48-51
+    MSG = _mm_add_epi32(MSG0, _mm_set_epi64x(0x34B0BCB52748774CULL, 0x1E376C0819A4C116ULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    TMP = _mm_alignr_epi8(MSG0, MSG3, 4);
+    MSG1 = _mm_add_epi32(MSG1, TMP);
+    MSG1 = _mm_sha256msg2_epu32(MSG1, MSG0);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+    MSG3 = _mm_sha256msg1_epu32(MSG3, MSG0);
+
+    // Rounds 52-55
+    MSG = _mm_add_epi32(MSG1, _mm_set_epi64x(0x682E6FF35B9CCA4FULL, 0x4ED8AA4A391C0CB3ULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    TMP = _mm_alignr_epi8(MSG1, MSG0, 4);
+    MSG2 = _mm_add_epi32(MSG2, TMP);
+    MSG2 = _mm_sha256msg2_epu32(MSG2, MSG1);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+
+    // Rounds 56-59
+    MSG = _mm_add_epi32(MSG2, _mm_set_epi64x(0x8CC7020884C87814ULL, 0x78A5636F748F82EEULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    TMP = _mm_alignr_epi8(MSG2, MSG1, 4);
+    MSG3 = _mm_add_epi32(MSG3, TMP);
+    MSG3 = _mm_sha256msg2_epu32(MSG3, MSG2);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+
+    // Rounds 60-63
+    MSG = _mm_add_epi32(MSG3, _mm_set_epi64x(0xC67178F2BEF9A3F7ULL, 0xA4506CEB90BEFFFAULL));
+    STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+    MSG = _mm_shuffle_epi32(MSG, 0x0E);
+    STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+
+    // Add the compressed block back into the saved state
+    STATE0 = _mm_add_epi32(STATE0, ABEF_SAVE);
+    STATE1 = _mm_add_epi32(STATE1, CDGH_SAVE);
+
+    // Rearrange back to the ABCD/EFGH order of the state array and store
+    TMP = _mm_shuffle_epi32(STATE0, 0x1B);       // FEBA
+    STATE1 = _mm_shuffle_epi32(STATE1, 0xB1);    // DCHG
+    STATE0 = _mm_blend_epi16(TMP, STATE1, 0xF0); // DCBA
+    STATE1 = _mm_alignr_epi8(STATE1, TMP, 8);    // HGFE
+    _mm_storeu_si128((__m128i *)&state[0], STATE0);
+    _mm_storeu_si128((__m128i *)&state[4], STATE1);
+}
+#elif defined(__aarch64__)
+// Compresses one 512-bit block using the ARMv8 cryptography extensions. vsha256hq/vsha256h2q
+// each perform four rounds on the two state halves, vsha256su0q/vsha256su1q compute the schedule.
+__attribute__((target("+crypto")))
+void compressBlockArmCrypto(std::array<unsigned int, 8> &state, const unsigned char *block){
+    uint32x4_t STATE0 = vld1q_u32(&state[0]);
+    uint32x4_t STATE1 = vld1q_u32(&state[4]);
+    uint32x4_t ABEF_SAVE = STATE0;
+    uint32x4_t CDGH_SAVE = STATE1;
+
+    // Load the block and convert the words to big-endian
+    uint32x4_t MSG0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(block + 0)));
+    uint32x4_t MSG1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(block + 16)));
+    uint32x4_t MSG2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(block + 32)));
+    uint32x4_t MSG3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(block + 48)));
+
+    uint32x4_t TMP0 = vaddq_u32(MSG0, vld1q_u32(&K[0]));
+    uint32x4_t TMP1, TMP2;
+
+    // Four rounds at a time: hash updates interleaved with the schedule extension
+    for (int t = 0; t < 12; ++t){
+        TMP1 = vaddq_u32(MSG1, vld1q_u32(&K[(t + 1) * 4]));
+        TMP2 = STATE0;
+        MSG0 = vsha256su0q_u32(MSG0, MSG1);
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+        MSG0 = vsha256su1q_u32(MSG0, MSG2, MSG3);
+        // rotate the message registers
+        uint32x4_t ROT = MSG0;
+        MSG0 = MSG1;
+        MSG1 = MSG2;
+        MSG2 = MSG3;
+        MSG3 = ROT;
+        TMP0 = TMP1;
     }
-    return 0;
+
+    // The final 16 rounds need no further schedule extension
+    for (int t = 13; t <= 15; ++t){
+        TMP1 = vaddq_u32(MSG1, vld1q_u32(&K[t * 4]));
+        TMP2 = STATE0;
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+        MSG1 = MSG2;
+        MSG2 = MSG3;
+        TMP0 = TMP1;
+    }
+    TMP2 = STATE0;
+    STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+    STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+
+    // Add the compressed block back into the saved state and store
+    STATE0 = vaddq_u32(STATE0, ABEF_SAVE);
+    STATE1 = vaddq_u32(STATE1, CDGH_SAVE);
+    vst1q_u32(&state[0], STATE0);
+    vst1q_u32(&state[4], STATE1);
+}
+#endif
+
+// The compression function to use for every block, chosen once at startup
+typedef void (*CompressFunction)(std::array<unsigned int, 8> &state, const unsigned char *block);
+
+// Whether a dedicated hardware kernel was picked; the dual-stream kernel below only
+// pays off without one
+bool hasShaExtensions = false;
+
+// Picks the fastest compression kernel the machine we are running on supports
+CompressFunction pickCompressFunction(){
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1")){
+        hasShaExtensions = true;
+        return compressBlockShaNi;
+    }
+#elif defined(__aarch64__)
+    if (getauxval(AT_HWCAP) & HWCAP_SHA2){
+        hasShaExtensions = true;
+        return compressBlockArmCrypto;
+    }
+#endif
+    return compressBlockScalar;
+}
+
+CompressFunction compressBlock = pickCompressFunction();
+
+// Everything a streaming context needs to resume from: the chaining state, the buffered
+// partial block and the running length. Captured by snapshot(), replayed by restore().
+struct Sha256Snapshot {
+    std::array<unsigned int, 8> state;
+    unsigned char buffer[64];
+    unsigned long long totalBytes;
+    unsigned int bufferedBytes;
+};
+
+/*
+ A streaming hashing context following the usual init/update/final pattern.
+ Instead of padding and parsing a full copy of the message up front, the context
+ consumes the message in 64-byte blocks as they arrive and only ever keeps the
+ 8-word running hash state plus at most one partial block. Memory use therefore
+ stays constant no matter how large the message is.
+*/
+class Sha256Context {
+public:
+    // Sets the initial hash value H0, according to specification
+    void init(){
+        state = {H0[0], H0[1], H0[2], H0[3], H0[4], H0[5], H0[6], H0[7]};
+        totalBytes = 0;
+        bufferedBytes = 0;
+    }
+
+    // Consumes the next part of the message. Complete 64-byte blocks are compressed
+    // right away, a trailing partial block is kept in the buffer until more data arrives.
+    void update(const unsigned char *data, unsigned long long length){
+        totalBytes += length;
+        // If a previous call left a partial block behind, fill it up first
+        if (bufferedBytes > 0){
+            while (bufferedBytes < 64 && length > 0){
+                buffer[bufferedBytes++] = *data++;
+                --length;
+            }
+            if (bufferedBytes == 64){
+                compressBlock(state, buffer);
+                bufferedBytes = 0;
+            }
+        }
+        // Compress all complete blocks straight from the input, asking for the next
+        // block while the current one is in the rounds
+        while (length >= 64){
+            __builtin_prefetch(data + 64);
+            compressBlock(state, data);
+            data += 64;
+            length -= 64;
+        }
+        // Keep whatever is left for the next update or for final
+        while (length > 0){
+            buffer[bufferedBytes++] = *data++;
+            --length;
+        }
+    }
+
+    // Pads the remainder of the message according to section 5.1 and returns the digest.
+    // The amount of padding is a closed-form expression of the buffered length (the k of
+    // section 5.1.1 is just the gap up to byte 56), so the fill is a memset instead of a loop.
+    std::array<unsigned int, 8> final(){
+        unsigned long long l = totalBytes * 8;
+        // Append a 1 before the least significant bit in the message
+        buffer[bufferedBytes++] = 0x80;
+        // If there is no room left for the 64-bit length, this block is all padding
+        if (bufferedBytes > 56){
+            memset(buffer + bufferedBytes, 0, 64 - bufferedBytes);
+            compressBlock(state, buffer);
+            bufferedBytes = 0;
+        }
+        memset(buffer + bufferedBytes, 0, 56 - bufferedBytes);
+        // Append the length (l) as the big-endian final quadword
+        for (int i = 0; i < 8; ++i){
+            buffer[56 + i] = l >> (56 - i * 8);
+        }
+        compressBlock(state, buffer);
+        return state;
+    }
+
+    // Captures the current midstate, so a shared message prefix can be compressed once
+    // and each per-message suffix resumed from the copy. Cheapest when taken at a block
+    // boundary (an empty buffer), but a buffered tail is carried along correctly too.
+    Sha256Snapshot snapshot() const {
+        Sha256Snapshot s;
+        s.state = state;
+        memcpy(s.buffer, buffer, bufferedBytes);
+        s.totalBytes = totalBytes;
+        s.bufferedBytes = bufferedBytes;
+        return s;
+    }
+
+    // Resets the context to a previously captured midstate
+    void restore(const Sha256Snapshot &s){
+        state = s.state;
+        memcpy(buffer, s.buffer, s.bufferedBytes);
+        totalBytes = s.totalBytes;
+        bufferedBytes = s.bufferedBytes;
+    }
+
+private:
+    // The 8-word running hash state, H^(i) in the specification
+    std::array<unsigned int, 8> state;
+    // At most one partial 512-bit block waiting for more data
+    unsigned char buffer[64];
+    // Total message length so far, needed for the padding in final
+    unsigned long long totalBytes;
+    // How many bytes of buffer are in use
+    unsigned int bufferedBytes;
+};
+
+
+// Serializes a digest into its 32 big-endian bytes, the form a digest has when it is
+// itself the message of another hash (as in HMAC's outer pass)
+void digestToBytes(const std::array<unsigned int, 8> &digest, unsigned char *out){
+    for (int i = 0; i < 8; ++i){
+        out[i * 4] = digest[i] >> 24;
+        out[i * 4 + 1] = digest[i] >> 16;
+        out[i * 4 + 2] = digest[i] >> 8;
+        out[i * 4 + 3] = digest[i];
+    }
+}
+
+/*
+ The rest of the SHA-2 family. SHA-224/256 and SHA-384/512 share the exact structure of
+ section 6 - only the word size, the rotation amounts, the constants, the round count
+ and the output truncation differ - so the core below is templated on a traits struct
+ and each variant is a zero-overhead compile-time specialization: the round loop is
+ monomorphized per algorithm, with no dispatch inside it. SHA-256 keeps its dedicated
+ kernels (SHA extensions, multi-buffer lanes) above; this core serves the others.
+*/
+
+// A width-generic ROTR, section 3.2. The unsigned int overload above predates this one
+// and stays for the SHA-256 core.
+template <typename Word>
+constexpr Word rotateRight(int n, Word x){
+    return (x >> n) | (x << (sizeof(Word) * 8 - n));
+}
+
+struct Sha224Traits {
+    typedef unsigned int Word;
+    static const int rounds = 64;
+    static const int blockBytes = 64;
+    static const int digestWords = 7; // the last state word is dropped, section 6.3
+    static constexpr const Word *roundConstants(){ return K; }
+    static constexpr Word initial[8] = {0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+                                        0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4};
+    static constexpr Word capitalSigma0(Word x){ return rotateRight(2, x) ^ rotateRight(13, x) ^ rotateRight(22, x); }
+    static constexpr Word capitalSigma1(Word x){ return rotateRight(6, x) ^ rotateRight(11, x) ^ rotateRight(25, x); }
+    static constexpr Word lowercaseSigma0(Word x){ return rotateRight(7, x) ^ rotateRight(18, x) ^ (x >> 3); }
+    static constexpr Word lowercaseSigma1(Word x){ return rotateRight(17, x) ^ rotateRight(19, x) ^ (x >> 10); }
+};
+
+// The constants for SHA-384/512: the fractional parts of the cube roots of the first
+// eighty primes, section 4.2.3
+alignas(64) constexpr unsigned long long K512[80] =
+                 {0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+                  0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+                  0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+                  0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+                  0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+                  0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+                  0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+                  0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+                  0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+                  0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+                  0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+                  0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+                  0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+                  0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+                  0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+                  0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+                  0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+                  0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+                  0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+                  0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL};
+
+struct Sha512Traits {
+    typedef unsigned long long Word;
+    static const int rounds = 80;
+    static const int blockBytes = 128;
+    static const int digestWords = 8;
+    static constexpr const Word *roundConstants(){ return K512; }
+    static constexpr Word initial[8] = {0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+                                        0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+                                        0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+                                        0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL};
+    static constexpr Word capitalSigma0(Word x){ return rotateRight(28, x) ^ rotateRight(34, x) ^ rotateRight(39, x); }
+    static constexpr Word capitalSigma1(Word x){ return rotateRight(14, x) ^ rotateRight(18, x) ^ rotateRight(41, x); }
+    static constexpr Word lowercaseSigma0(Word x){ return rotateRight(1, x) ^ rotateRight(8, x) ^ (x >> 7); }
+    static constexpr Word lowercaseSigma1(Word x){ return rotateRight(19, x) ^ rotateRight(61, x) ^ (x >> 6); }
+};
+
+// SHA-384 is SHA-512 with a different initial hash value and the output cut to six
+// words, section 6.4
+struct Sha384Traits : Sha512Traits {
+    static const int digestWords = 6;
+    static constexpr Word initial[8] = {0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL,
+                                        0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+                                        0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL,
+                                        0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL};
+};
+
+/*
+ The generic streaming context, the same init/update/final shape as Sha256Context with
+ the traits supplying every algorithm-specific piece. The message schedule is the same
+ 16-word rolling window as the SHA-256 core, sized by the traits' word.
+*/
+template <typename Traits>
+class ShaContext {
+public:
+    typedef typename Traits::Word Word;
+    static const int digestBytes = Traits::digestWords * (int)sizeof(Word);
+
+    void init(){
+        for (int i = 0; i < 8; ++i){
+            state[i] = Traits::initial[i];
+        }
+        totalBytes = 0;
+        bufferedBytes = 0;
+    }
+
+    void update(const unsigned char *data, unsigned long long length){
+        totalBytes += length;
+        if (bufferedBytes > 0){
+            while (bufferedBytes < (unsigned int)Traits::blockBytes && length > 0){
+                buffer[bufferedBytes++] = *data++;
+                --length;
+            }
+            if (bufferedBytes == (unsigned int)Traits::blockBytes){
+                compress(buffer);
+                bufferedBytes = 0;
+            }
+        }
+        while (length >= (unsigned long long)Traits::blockBytes){
+            compress(data);
+            data += Traits::blockBytes;
+            length -= Traits::blockBytes;
+        }
+        while (length > 0){
+            buffer[bufferedBytes++] = *data++;
+            --length;
+        }
+    }
+
+    // Pads per section 5.1 and writes the digest's bytes to out. The length field is
+    // two words wide for SHA-384/512 (128 bits) and one for SHA-224; the loop below
+    // writes the low 64 bits of the bit length into the last 8 bytes and zero-fills
+    // the rest, which covers every message shorter than 2^61 bytes.
+    void final(unsigned char *out){
+        unsigned long long l = totalBytes * 8;
+        const int lengthBytes = Traits::blockBytes == 128 ? 16 : 8;
+        const int lengthStart = Traits::blockBytes - lengthBytes;
+        buffer[bufferedBytes++] = 0x80;
+        if (bufferedBytes > (unsigned int)lengthStart){
+            memset(buffer + bufferedBytes, 0, Traits::blockBytes - bufferedBytes);
+            compress(buffer);
+            bufferedBytes = 0;
+        }
+        memset(buffer + bufferedBytes, 0, lengthStart - bufferedBytes);
+        memset(buffer + lengthStart, 0, lengthBytes - 8);
+        for (int i = 0; i < 8; ++i){
+            buffer[Traits::blockBytes - 8 + i] = l >> (56 - i * 8);
+        }
+        compress(buffer);
+        for (int i = 0; i < Traits::digestWords; ++i){
+            for (int b = 0; b < (int)sizeof(Word); ++b){
+                out[i * sizeof(Word) + b] = state[i] >> ((sizeof(Word) - 1 - b) * 8);
+            }
+        }
+    }
+
+private:
+    void compress(const unsigned char *block){
+        const Word *roundConstants = Traits::roundConstants();
+        Word W[16];
+        for (int t = 0; t < 16; ++t){
+            Word w = 0;
+            for (int b = 0; b < (int)sizeof(Word); ++b){
+                w = (w << 8) | block[t * sizeof(Word) + b];
+            }
+            W[t] = w;
+        }
+        Word a = state[0], b = state[1], c = state[2], d = state[3];
+        Word e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int t = 0; t < Traits::rounds; ++t){
+            if (t >= 16){
+                // The same rolling 16-word schedule window as the SHA-256 core
+                W[t & 15] = Traits::lowercaseSigma1(W[(t - 2) & 15]) + W[(t - 7) & 15]
+                          + Traits::lowercaseSigma0(W[(t - 15) & 15]) + W[t & 15];
+            }
+            // Ch and Maj written out, since the SHA-256 core's helpers are 32-bit
+            Word T1 = h + Traits::capitalSigma1(e) + ((e & f) ^ (~e & g)) + roundConstants[t] + W[t & 15];
+            Word T2 = Traits::capitalSigma0(a) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + T1;
+            d = c; c = b; b = a; a = T1 + T2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+
+    Word state[8];
+    unsigned char buffer[Traits::blockBytes];
+    unsigned long long totalBytes;
+    unsigned int bufferedBytes;
+};
+
+/*
+ HMAC-SHA256 (RFC 2104). The key-derived ipad and opad blocks are the same for every
+ message, so their compressed states are computed once when the key is set and cloned
+ per message: each HMAC then costs the message blocks plus a single extra compression
+ for the outer pass, instead of two additional key blocks every time.
+*/
+class HmacSha256 {
+public:
+    void setKey(const unsigned char *key, unsigned long long length){
+        // Keys longer than one block are replaced by their digest, per RFC 2104
+        unsigned char keyBlock[64] = {0};
+        if (length > 64){
+            Sha256Context context;
+            context.init();
+            context.update(key, length);
+            digestToBytes(context.final(), keyBlock);
+        } else {
+            memcpy(keyBlock, key, length);
+        }
+
+        // The midstates after one compression of key^ipad and key^opad
+        unsigned char pad[64];
+        for (int i = 0; i < 64; ++i){
+            pad[i] = keyBlock[i] ^ 0x36;
+        }
+        innerMidstate.init();
+        innerMidstate.update(pad, 64);
+        for (int i = 0; i < 64; ++i){
+            pad[i] = keyBlock[i] ^ 0x5c;
+        }
+        outerMidstate.init();
+        outerMidstate.update(pad, 64);
+    }
+
+    // A clone of the inner midstate, ready to take message bytes via update()
+    Sha256Context innerContext() const {
+        return innerMidstate;
+    }
+
+    // Finishes the HMAC for a consumed inner context
+    std::array<unsigned int, 8> finish(Sha256Context &inner) const {
+        unsigned char innerBytes[32];
+        digestToBytes(inner.final(), innerBytes);
+        Sha256Context outer = outerMidstate;
+        outer.update(innerBytes, 32);
+        return outer.final();
+    }
+
+    // The full HMAC of one in-memory message
+    std::array<unsigned int, 8> compute(const unsigned char *message, unsigned long long length) const {
+        Sha256Context inner = innerMidstate;
+        inner.update(message, length);
+        return finish(inner);
+    }
+
+private:
+    Sha256Context innerMidstate;
+    Sha256Context outerMidstate;
+};
+
+// The key loaded by --hmac; when set, every mode authenticates instead of plain-hashing
+HmacSha256 hmacKey;
+bool hmacMode = false;
+
+/*
+ Multi-buffer hashing. Many independent small messages leave most of the SIMD width
+ of a core idle, so these kernels transpose the message schedules of several messages
+ into vector lanes and run the round function across all of them at once. The lane
+ kernels are written once against GCC's generic vector types and instantiated per
+ width, so the same round logic serves SSE (4 lanes), AVX2 (8) and AVX-512 (16).
+*/
+
+// A non-owning view of a message to be hashed
+struct MessageView {
+    const unsigned char *data;
+    unsigned long long length;
+};
+
+// The lane helpers are only ever inlined into the width-specific wrappers below, so the
+// vector ABI warnings GCC raises about their signatures can never actually bite.
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+// Vector types holding one 32-bit word of 4, 8 or 16 different messages
+typedef unsigned int u32x4 __attribute__((vector_size(16)));
+typedef unsigned int u32x8 __attribute__((vector_size(32)));
+typedef unsigned int u32x16 __attribute__((vector_size(64)));
+
+// Lane-parallel versions of the logical functions from section 4.1.2, one lane per message
+template <typename V>
+__attribute__((always_inline)) inline V laneROTR(int n, V x){
+    return (x >> n) | (x << (32 - n));
+}
+template <typename V>
+__attribute__((always_inline)) inline V laneCh(V x, V y, V z){
+    return (x & y) ^ (~x & z);
+}
+template <typename V>
+__attribute__((always_inline)) inline V laneMaj(V x, V y, V z){
+    return (x & y) ^ (x & z) ^ (y & z);
+}
+template <typename V>
+__attribute__((always_inline)) inline V laneCapitalSigma0(V x){
+    return laneROTR(2, x) ^ laneROTR(13, x) ^ laneROTR(22, x);
+}
+template <typename V>
+__attribute__((always_inline)) inline V laneCapitalSigma1(V x){
+    return laneROTR(6, x) ^ laneROTR(11, x) ^ laneROTR(25, x);
+}
+template <typename V>
+__attribute__((always_inline)) inline V laneLowercaseSigma0(V x){
+    return laneROTR(7, x) ^ laneROTR(18, x) ^ (x >> 3);
+}
+template <typename V>
+__attribute__((always_inline)) inline V laneLowercaseSigma1(V x){
+    return laneROTR(17, x) ^ laneROTR(19, x) ^ (x >> 10);
+}
+
+// How many 512-bit blocks a message occupies once padded according to section 5.1
+unsigned long long paddedBlockCount(unsigned long long length){
+    return length / 64 + (length % 64 >= 56 ? 2 : 1);
+}
+
+// Writes block blockIndex of the padded form of message into out. Used for the blocks
+// that do not exist verbatim in the message data: the tail carrying 0x80 and the length.
+void buildPaddedBlock(const MessageView &message, unsigned long long blockIndex, unsigned char *out){
+    unsigned long long offset = blockIndex * 64;
+    memset(out, 0, 64);
+    if (offset < message.length){
+        unsigned long long n = message.length - offset;
+        memcpy(out, message.data + offset, n < 64 ? n : 64);
+    }
+    // The 1 bit right after the message contents
+    if (message.length >= offset && message.length < offset + 64){
+        out[message.length - offset] = 0x80;
+    }
+    // The 64-bit message length closes the very last block
+    if (blockIndex == paddedBlockCount(message.length) - 1){
+        unsigned long long l = message.length * 8;
+        for (int i = 1; i < 9; ++i){
+            out[55 + i] = l >> (64 - i * 8);
+        }
+    }
+}
+
+/*
+ Hashes up to NLANES messages in lockstep, one message per vector lane. All lanes run
+ the same block index each iteration; lanes whose message is already fully consumed
+ keep compressing their last block but have the state update masked out, so shorter
+ messages simply coast until the longest one finishes.
+*/
+template <typename V, int NLANES>
+__attribute__((always_inline)) inline
+void sha256LanesBody(const MessageView *messages, std::array<unsigned int, 8> *digests, int laneCount){
+    // Per-lane block counts, and the number of iterations the whole group needs
+    unsigned long long numBlocks[NLANES];
+    unsigned long long maxBlocks = 0;
+    for (int l = 0; l < laneCount; ++l){
+        numBlocks[l] = paddedBlockCount(messages[l].length);
+        if (numBlocks[l] > maxBlocks){
+            maxBlocks = numBlocks[l];
+        }
+    }
+
+    // Every lane starts from the initial hash value H0
+    V state[8];
+    for (int i = 0; i < 8; ++i){
+        for (int l = 0; l < NLANES; ++l){
+            state[i][l] = H0[i];
+        }
+    }
+
+    unsigned char tailBlock[NLANES][64];
+    memset(tailBlock, 0, sizeof(tailBlock));
+
+    for (unsigned long long b = 0; b < maxBlocks; ++b){
+        // Find the 64 bytes each lane compresses this iteration
+        const unsigned char *blockPointer[NLANES];
+        V active = {};
+        for (int l = 0; l < NLANES; ++l){
+            if (l >= laneCount){
+                blockPointer[l] = tailBlock[l];
+                continue;
+            }
+            if (b < messages[l].length / 64){
+                // A complete block straight from the message data; ask for the next
+                // one while this round of blocks is being transposed and compressed
+                blockPointer[l] = messages[l].data + b * 64;
+                __builtin_prefetch(blockPointer[l] + 64);
+            } else {
+                // A padding block, or a repeat of the last one for lanes that are done
+                unsigned long long idx = b < numBlocks[l] ? b : numBlocks[l] - 1;
+                buildPaddedBlock(messages[l], idx, tailBlock[l]);
+                blockPointer[l] = tailBlock[l];
+            }
+            active[l] = b < numBlocks[l] ? 0xFFFFFFFFu : 0;
+        }
+
+        // Transpose the message schedule: lane l of W[t] is word t of lane l's block
+        V W[64];
+        for (int t = 0; t <= 15; ++t){
+            for (int l = 0; l < NLANES; ++l){
+                W[t][l] = loadBigEndian32(blockPointer[l] + t * 4);
+            }
+        }
+        for (int t = 16; t <= 63; ++t){
+            W[t] = laneLowercaseSigma1(W[t - 2]) + W[t - 7] + laneLowercaseSigma0(W[t - 15]) + W[t - 16];
+        }
+
+        // The round ladder of section 6.2.2, across all lanes at once
+        V a = state[0], b_ = state[1], c = state[2], d = state[3];
+        V e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int t = 0; t <= 63; ++t){
+            V T1 = h + laneCapitalSigma1(e) + laneCh(e, f, g) + K[t] + W[t];
+            V T2 = laneCapitalSigma0(a) + laneMaj(a, b_, c);
+            h = g;
+            g = f;
+            f = e;
+            e = d + T1;
+            d = c;
+            c = b_;
+            b_ = a;
+            a = T1 + T2;
+        }
+
+        // Fold the block into the running state, but only for lanes that still had a real block
+        state[0] = (active & (state[0] + a)) | (~active & state[0]);
+        state[1] = (active & (state[1] + b_)) | (~active & state[1]);
+        state[2] = (active & (state[2] + c)) | (~active & state[2]);
+        state[3] = (active & (state[3] + d)) | (~active & state[3]);
+        state[4] = (active & (state[4] + e)) | (~active & state[4]);
+        state[5] = (active & (state[5] + f)) | (~active & state[5]);
+        state[6] = (active & (state[6] + g)) | (~active & state[6]);
+        state[7] = (active & (state[7] + h)) | (~active & state[7]);
+    }
+
+    // Untranspose the finished states into the digests
+    for (int l = 0; l < laneCount; ++l){
+        for (int i = 0; i < 8; ++i){
+            digests[l][i] = state[i][l];
+        }
+    }
+}
+
+// One instantiation per vector width. The wrappers carry the target attributes so the
+// generic body above is compiled for the widest instruction set each machine offers.
+void sha256Lanes4(const MessageView *messages, std::array<unsigned int, 8> *digests, int laneCount){
+    sha256LanesBody<u32x4, 4>(messages, digests, laneCount);
+}
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+void sha256Lanes8(const MessageView *messages, std::array<unsigned int, 8> *digests, int laneCount){
+    sha256LanesBody<u32x8, 8>(messages, digests, laneCount);
+}
+__attribute__((target("avx512f,avx512bw")))
+void sha256Lanes16(const MessageView *messages, std::array<unsigned int, 8> *digests, int laneCount){
+    sha256LanesBody<u32x16, 16>(messages, digests, laneCount);
+}
+#endif
+
+// The lane kernel and width to use on this machine, chosen once at startup like compressBlock
+typedef void (*LaneFunction)(const MessageView *messages, std::array<unsigned int, 8> *digests, int laneCount);
+LaneFunction pickLaneFunction(int &width){
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")){
+        width = 16;
+        return sha256Lanes16;
+    }
+    if (__builtin_cpu_supports("avx2")){
+        width = 8;
+        return sha256Lanes8;
+    }
+#endif
+    width = 4;
+    return sha256Lanes4;
+}
+
+int laneWidth;
+LaneFunction sha256Lanes = pickLaneFunction(laneWidth);
+
+// Hashes count independent messages, filling one digest per message. Messages are fed
+// to the lane kernel in full-width groups, the leftovers go through in a partial group.
+// Hashes exactly two messages through the dual-stream kernel: both block streams run
+// interleaved while each still has real blocks, and the longer one finishes alone
+void sha256TwoInterleaved(const MessageView &messageA, const MessageView &messageB,
+                          std::array<unsigned int, 8> &digestA, std::array<unsigned int, 8> &digestB){
+    digestA = {H0[0], H0[1], H0[2], H0[3], H0[4], H0[5], H0[6], H0[7]};
+    digestB = digestA;
+    unsigned long long blocksA = paddedBlockCount(messageA.length);
+    unsigned long long blocksB = paddedBlockCount(messageB.length);
+    unsigned long long shared = blocksA < blocksB ? blocksA : blocksB;
+    unsigned char tailA[64], tailB[64];
+    for (unsigned long long b = 0; b < shared; ++b){
+        const unsigned char *blockA = messageA.data + b * 64;
+        const unsigned char *blockB = messageB.data + b * 64;
+        if ((b + 1) * 64 > messageA.length){
+            buildPaddedBlock(messageA, b, tailA);
+            blockA = tailA;
+        }
+        if ((b + 1) * 64 > messageB.length){
+            buildPaddedBlock(messageB, b, tailB);
+            blockB = tailB;
+        }
+        compressBlockDual(digestA, blockA, digestB, blockB);
+    }
+    const MessageView &longer = blocksA > blocksB ? messageA : messageB;
+    std::array<unsigned int, 8> &rest = blocksA > blocksB ? digestA : digestB;
+    unsigned long long total = blocksA > blocksB ? blocksA : blocksB;
+    for (unsigned long long b = shared; b < total; ++b){
+        const unsigned char *block = longer.data + b * 64;
+        if ((b + 1) * 64 > longer.length){
+            buildPaddedBlock(longer, b, tailA);
+            block = tailA;
+        }
+        compressBlock(rest, block);
+    }
+}
+
+void sha256Many(const MessageView *messages, std::array<unsigned int, 8> *digests, unsigned long long count){
+    unsigned long long done = 0;
+    while (count - done >= (unsigned long long)laneWidth){
+        sha256Lanes(messages + done, digests + done, laneWidth);
+        done += laneWidth;
+    }
+    // A pair left over on a core without SHA extensions: the dual-stream kernel does
+    // the two real messages' work, where the masked lane kernel would run half-empty
+    if (count - done == 2 && !hasShaExtensions){
+        sha256TwoInterleaved(messages[done], messages[done + 1], digests[done], digests[done + 1]);
+        return;
+    }
+    if (count - done > 0){
+        sha256Lanes(messages + done, digests + done, count - done);
+    }
+}
+
+/*
+ GPU offload. Billions of tiny independent messages are the textbook GPU workload:
+ one work item per message, the whole batch in flight at once. The engine sits behind
+ the same MessageView batch interface as the multi-buffer lanes, stages batches
+ through pinned host buffers and double-buffers the transfers, so the PCIe copy of one
+ batch overlaps the compute of the previous one. The kernel source is assembled at
+ startup with the K and H0 tables above spliced in, so the constants exist once in
+ this file. Built only where an OpenCL SDK is present; everywhere else - and whenever
+ no device answers at runtime - the CPU lanes keep the batch.
+*/
+#ifdef SHA256_HAVE_OPENCL
+
+// The device-side rounds; K and H0 are textually injected in front of this by
+// gpuKernelSource so the one definition in this file serves both sides
+const char *gpuKernelBody = R"CLC(
+#define rotr(n, x) (((x) >> (n)) | ((x) << (32 - (n))))
+
+// One byte of the padded message stream, synthesized on the fly: message bytes, the
+// 0x80 marker, zero fill, and the big-endian bit length closing the last block
+static uchar paddedByte(__global const uchar *message, uint length, uint totalBytes, uint pos){
+    if (pos < length) return message[pos];
+    if (pos == length) return 0x80;
+    if (pos >= totalBytes - 8){
+        ulong bits = (ulong)length * 8;
+        return (uchar)(bits >> (8 * (totalBytes - 1 - pos)));
+    }
+    return 0;
+}
+
+__kernel void sha256Batch(__global const uchar *data, __global const ulong *offsets,
+                          __global const uint *lengths, __global uint *digests){
+    size_t id = get_global_id(0);
+    __global const uchar *message = data + offsets[id];
+    uint length = lengths[id];
+    uint blocks = length / 64 + (length % 64 >= 56 ? 2 : 1);
+    uint totalBytes = blocks * 64;
+
+    uint state[8];
+    for (int i = 0; i < 8; ++i) state[i] = H[i];
+
+    for (uint b = 0; b < blocks; ++b){
+        uint W[16];
+        for (int t = 0; t < 16; ++t){
+            uint w = 0;
+            for (int i = 0; i < 4; ++i)
+                w = (w << 8) | paddedByte(message, length, totalBytes, b * 64 + t * 4 + i);
+            W[t] = w;
+        }
+        uint a = state[0], bb = state[1], c = state[2], d = state[3];
+        uint e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int t = 0; t < 64; ++t){
+            if (t >= 16)
+                W[t & 15] = (rotr(17, W[(t - 2) & 15]) ^ rotr(19, W[(t - 2) & 15]) ^ (W[(t - 2) & 15] >> 10))
+                          + W[(t - 7) & 15]
+                          + (rotr(7, W[(t - 15) & 15]) ^ rotr(18, W[(t - 15) & 15]) ^ (W[(t - 15) & 15] >> 3))
+                          + W[t & 15];
+            uint T1 = h + (rotr(6, e) ^ rotr(11, e) ^ rotr(25, e)) + ((e & f) ^ (~e & g)) + K[t] + W[t & 15];
+            uint T2 = (rotr(2, a) ^ rotr(13, a) ^ rotr(22, a)) + ((a & bb) ^ (a & c) ^ (bb & c));
+            h = g; g = f; f = e; e = d + T1;
+            d = c; c = bb; bb = a; a = T1 + T2;
+        }
+        state[0] += a; state[1] += bb; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+    for (int i = 0; i < 8; ++i) digests[id * 8 + i] = state[i];
+}
+)CLC";
+
+// Splices the host-side constant tables into the kernel source
+std::string gpuKernelSource(){
+    std::ostringstream source;
+    source << "__constant uint K[64] = {";
+    for (int i = 0; i < 64; ++i){
+        source << K[i] << (i < 63 ? "u," : "u};\n");
+    }
+    source << "__constant uint H[8] = {";
+    for (int i = 0; i < 8; ++i){
+        source << H0[i] << (i < 7 ? "u," : "u};\n");
+    }
+    source << gpuKernelBody;
+    return source.str();
+}
+
+class GpuEngine {
+public:
+    // Finds a device and builds the kernel; any failure just leaves the engine
+    // unavailable and the CPU lanes carry on
+    bool init(){
+        cl_platform_id platform;
+        cl_device_id device;
+        if (clGetPlatformIDs(1, &platform, nullptr) != CL_SUCCESS ||
+            clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 1, &device, nullptr) != CL_SUCCESS){
+            return false;
+        }
+        cl_int status;
+        context = clCreateContext(nullptr, 1, &device, nullptr, nullptr, &status);
+        if (status != CL_SUCCESS){
+            return false;
+        }
+        queue = clCreateCommandQueue(context, device, 0, &status);
+        if (status != CL_SUCCESS){
+            return false;
+        }
+        std::string source = gpuKernelSource();
+        const char *text = source.c_str();
+        size_t length = source.size();
+        program = clCreateProgramWithSource(context, 1, &text, &length, &status);
+        if (status != CL_SUCCESS || clBuildProgram(program, 1, &device, "", nullptr, nullptr) != CL_SUCCESS){
+            return false;
+        }
+        kernel = clCreateKernel(program, "sha256Batch", &status);
+        if (status != CL_SUCCESS){
+            return false;
+        }
+        // Two staging slots so batch n+1 packs and uploads while batch n computes.
+        // The pinned buffer exists only to be mapped once and used as the host-side
+        // source of the uploads; the device never touches it, so the mapping can stay
+        // live while commands run against the separate device-side data buffer.
+        for (Slot &slot : slots){
+            slot.pinned = clCreateBuffer(context, CL_MEM_ALLOC_HOST_PTR, stagingBytes, nullptr, &status);
+            if (status != CL_SUCCESS) return false;
+            slot.data = clCreateBuffer(context, CL_MEM_READ_ONLY, stagingBytes, nullptr, &status);
+            if (status != CL_SUCCESS) return false;
+            slot.offsets = clCreateBuffer(context, CL_MEM_READ_ONLY, slotMessages * sizeof(cl_ulong), nullptr, &status);
+            if (status != CL_SUCCESS) return false;
+            slot.lengths = clCreateBuffer(context, CL_MEM_READ_ONLY, slotMessages * sizeof(cl_uint), nullptr, &status);
+            if (status != CL_SUCCESS) return false;
+            slot.digests = clCreateBuffer(context, CL_MEM_WRITE_ONLY, slotMessages * 32, nullptr, &status);
+            if (status != CL_SUCCESS) return false;
+            // Mapping an ALLOC_HOST_PTR buffer gives page-locked memory
+            slot.staging = (unsigned char *)clEnqueueMapBuffer(queue, slot.pinned, CL_TRUE, CL_MAP_WRITE, 0, stagingBytes, 0, nullptr, nullptr, &status);
+            if (status != CL_SUCCESS) return false;
+        }
+        ready = true;
+        return true;
+    }
+
+    bool available() const {
+        return ready;
+    }
+
+    // Hashes one batch through the two slots. Returns false (leaving the batch to the
+    // CPU) when a message does not fit the packing limits, so correctness never
+    // depends on the device path. One engine serves every pool worker, and the slots,
+    // the queue and the kernel object (whose clSetKernelArg is not thread-safe) are
+    // all engine state, so batches take the engine one at a time; the device already
+    // parallelizes within a batch, overlapping callers would only interleave garbage.
+    bool hashBatch(const MessageView *messages, std::array<unsigned int, 8> *digests, unsigned long long count){
+        std::lock_guard<std::mutex> lock(engineMutex);
+        for (unsigned long long i = 0; i < count; ++i){
+            if (messages[i].length > maxMessageBytes){
+                return false;
+            }
+        }
+        unsigned long long submitted[2] = {0, 0};
+        unsigned long long submittedAt[2] = {0, 0};
+        int slotIndex = 0;
+        unsigned long long done = 0;
+        bool ok = true;
+        while (ok && (done < count || submitted[0] > 0 || submitted[1] > 0)){
+            Slot &slot = slots[slotIndex];
+            // Collect the results the other use of this slot produced
+            if (submitted[slotIndex] > 0){
+                ok = clEnqueueReadBuffer(queue, slot.digests, CL_TRUE, 0, submitted[slotIndex] * 32,
+                                         digests + submittedAt[slotIndex], 1, &slot.kernelDone, nullptr) == CL_SUCCESS;
+                clReleaseEvent(slot.kernelDone);
+                slot.kernelDone = nullptr;
+                submitted[slotIndex] = 0;
+            }
+            if (ok && done < count){
+                // Pack the next run of messages into the pinned staging area
+                unsigned long long n = 0, bytes = 0;
+                std::vector<cl_ulong> offsets;
+                std::vector<cl_uint> lengths;
+                while (done + n < count && n < slotMessages && bytes + messages[done + n].length <= stagingBytes){
+                    const MessageView &message = messages[done + n];
+                    memcpy(slot.staging + bytes, message.data, message.length);
+                    offsets.push_back(bytes);
+                    lengths.push_back(message.length);
+                    bytes += message.length;
+                    ++n;
+                }
+                // Any failure from here on abandons the device for this batch; a digest
+                // must never come from a half-submitted pipeline
+                ok = clEnqueueWriteBuffer(queue, slot.data, CL_FALSE, 0, bytes, slot.staging, 0, nullptr, nullptr) == CL_SUCCESS
+                  && clEnqueueWriteBuffer(queue, slot.offsets, CL_FALSE, 0, n * sizeof(cl_ulong), offsets.data(), 0, nullptr, nullptr) == CL_SUCCESS
+                  && clEnqueueWriteBuffer(queue, slot.lengths, CL_FALSE, 0, n * sizeof(cl_uint), lengths.data(), 0, nullptr, nullptr) == CL_SUCCESS
+                  && clSetKernelArg(kernel, 0, sizeof(cl_mem), &slot.data) == CL_SUCCESS
+                  && clSetKernelArg(kernel, 1, sizeof(cl_mem), &slot.offsets) == CL_SUCCESS
+                  && clSetKernelArg(kernel, 2, sizeof(cl_mem), &slot.lengths) == CL_SUCCESS
+                  && clSetKernelArg(kernel, 3, sizeof(cl_mem), &slot.digests) == CL_SUCCESS;
+                if (ok){
+                    size_t globalSize = n;
+                    ok = clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &globalSize, nullptr, 0, nullptr, &slot.kernelDone) == CL_SUCCESS;
+                }
+                if (ok){
+                    clFlush(queue);
+                    submitted[slotIndex] = n;
+                    submittedAt[slotIndex] = done;
+                    done += n;
+                }
+            }
+            slotIndex ^= 1;
+        }
+        if (!ok){
+            // Drain whatever was still in flight and drop its events; the caller
+            // re-hashes the whole batch on the CPU lanes
+            clFinish(queue);
+            for (Slot &slot : slots){
+                if (slot.kernelDone != nullptr){
+                    clReleaseEvent(slot.kernelDone);
+                    slot.kernelDone = nullptr;
+                }
+            }
+        }
+        return ok;
+    }
+
+private:
+    struct Slot {
+        cl_mem pinned = nullptr;
+        cl_mem data = nullptr;
+        cl_mem offsets = nullptr;
+        cl_mem lengths = nullptr;
+        cl_mem digests = nullptr;
+        unsigned char *staging = nullptr;
+        cl_event kernelDone = nullptr;
+    };
+    static const unsigned long long stagingBytes = 16 << 20;
+    static const unsigned long long slotMessages = 1 << 16;
+    static const unsigned long long maxMessageBytes = 4096;
+
+    cl_context context = nullptr;
+    cl_command_queue queue = nullptr;
+    cl_program program = nullptr;
+    cl_kernel kernel = nullptr;
+    Slot slots[2];
+    std::mutex engineMutex;
+    bool ready = false;
+};
+
+GpuEngine gpuEngine;
+#endif // SHA256_HAVE_OPENCL
+
+// Requested by --gpu; stays false when no SDK was built in or no device answered
+bool gpuMode = false;
+
+// How many lines are hashed per sha256Many call from main
+const int batchSize = 64;
+
+// Set when any input line failed to decode, so main can exit nonzero
+std::atomic<bool> sawInvalidInput(false);
+
+// The working buffers one thread needs to process a batch. Reset between batches but
+// never freed, so in steady state the decode/hash path performs no allocations at all:
+// the inner byte buffers and the view/digest arrays keep their high-water capacity.
+struct BatchArena {
+    // All of a batch's decoded messages live in one flat buffer, each starting on a
+    // 64-byte boundary, so the compression loop streams through contiguous memory
+    // instead of chasing per-line heap allocations
+    std::vector<unsigned char> storage;
+    unsigned char *alignedBase = nullptr;
+    std::vector<MessageView> views;
+    std::vector<std::array<unsigned int, 8>> digests;
+
+    // Grows the flat buffer to hold at least bytes and returns its 64-byte-aligned base
+    unsigned char *alignedBytes(unsigned long long bytes){
+        if (storage.size() < bytes + 63){
+            storage.resize(bytes + 63);
+            alignedBase = storage.data() + (64 - (unsigned long long)storage.data() % 64) % 64;
+        }
+        return alignedBase;
+    }
+};
+
+// Decodes and hashes a batch of input lines through the multi-buffer engine, using the
+// caller's arena for every intermediate buffer. Lines that are not valid hex are
+// reported on stderr and produce no digest, like sha256sum does with unreadable files;
+// the remaining lines keep their relative order. The returned digests live in the arena
+// and stay valid until its next use.
+const std::vector<std::array<unsigned int, 8>> &hashLines(const std::string_view *lines, unsigned long long count, BatchArena &arena){
+    unsigned long long needed = 0;
+    for (unsigned long long i = 0; i < count; ++i){
+        needed += (lines[i].length() / 2 + 63) & ~63ull;
+    }
+    unsigned char *base = arena.alignedBytes(needed);
+    arena.views.clear();
+    {
+        STATS_SCOPE(decodeCycles);
+        unsigned long long offset = 0;
+        for (unsigned long long i = 0; i < count; ++i){
+            unsigned long long length = lines[i].length() / 2;
+            if (!decodeHex(lines[i], base + offset)){
+                std::cerr << "sha256: skipping line that is not valid hex\n";
+                sawInvalidInput = true;
+                continue;
+            }
+            arena.views.push_back({base + offset, length});
+            offset += (length + 63) & ~63ull;
+        }
+    }
+    STATS_ADD(linesDecoded, arena.views.size());
+    arena.digests.resize(arena.views.size());
+    {
+        STATS_SCOPE(compressCycles);
+        if (hmacMode){
+            // HMAC chains two hashes per message, so it runs per message from the midstates
+            for (unsigned long long i = 0; i < arena.views.size(); ++i){
+                arena.digests[i] = hmacKey.compute(arena.views[i].data, arena.views[i].length);
+            }
+        } else {
+            bool handled = false;
+#ifdef SHA256_HAVE_OPENCL
+            if (gpuMode){
+                handled = gpuEngine.hashBatch(arena.views.data(), arena.digests.data(), arena.views.size());
+            }
+#endif
+            if (!handled){
+                sha256Many(arena.views.data(), arena.digests.data(), arena.views.size());
+            }
+        }
+    }
+#ifdef SHA256_STATS
+    for (const MessageView &view : arena.views){
+        STATS_ADD(bytesHashed, view.length);
+        STATS_ADD(blocksCompressed, paddedBlockCount(view.length));
+    }
+    STATS_FOLD();
+#endif
+    return arena.digests;
+}
+
+/*
+ Worker-pool mode. One reader (the main thread) feeds batches of lines into a bounded
+ queue, N workers pull batches and hash them, and finished digests pass through a
+ reordering stage so stdout order always matches input order no matter which worker
+ finishes first.
+*/
+
+/*
+ Double-buffered stdin reader. std::getline interleaves small syscall-backed reads with
+ the hashing, so the CPU waits on the pipe and the pipe waits on the CPU. The reader
+ thread here fills one 8 MiB buffer with read(2) while the hasher consumes the other;
+ the consumer splits a filled chunk into lines with memchr and hands out string_views
+ straight into the buffer. Only the one line that straddles a chunk boundary is ever
+ copied. Two chunks recycle through the handoff, so memory stays bounded no matter how
+ fast the producer is.
+*/
+struct InputChunk {
+    std::vector<char> bytes;
+    unsigned long long size = 0;
+};
+
+class ChunkReader {
+public:
+    ChunkReader(){
+        for (InputChunk &chunk : chunks){
+            chunk.bytes.resize(chunkBytes);
+            freeChunks.push(&chunk);
+        }
+        reader = std::thread([this]{ readLoop(); });
+    }
+
+    ~ChunkReader(){
+        reader.join();
+    }
+
+    // The next filled chunk, or nullptr once stdin is exhausted. The caller owns the
+    // chunk - and every string_view cut from it - until it calls recycle.
+    InputChunk *next(){
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [&]{ return !filledChunks.empty() || endOfInput; });
+        if (filledChunks.empty()){
+            return nullptr;
+        }
+        InputChunk *chunk = filledChunks.front();
+        filledChunks.pop();
+        return chunk;
+    }
+
+    void recycle(InputChunk *chunk){
+        std::unique_lock<std::mutex> lock(mutex);
+        freeChunks.push(chunk);
+        notFull.notify_one();
+    }
+
+private:
+    void readLoop(){
+        for (;;){
+            InputChunk *chunk;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                notFull.wait(lock, [&]{ return !freeChunks.empty(); });
+                chunk = freeChunks.front();
+                freeChunks.pop();
+            }
+            long long got = read(0, chunk->bytes.data(), chunkBytes);
+            std::unique_lock<std::mutex> lock(mutex);
+            if (got <= 0){
+                endOfInput = true;
+                notEmpty.notify_all();
+                return;
+            }
+            chunk->size = got;
+            filledChunks.push(chunk);
+            notEmpty.notify_one();
+        }
+    }
+
+    static const unsigned long long chunkBytes = 8 << 20;
+    InputChunk chunks[2];
+    std::queue<InputChunk *> freeChunks;
+    std::queue<InputChunk *> filledChunks;
+    bool endOfInput = false;
+    std::thread reader;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+};
+
+// Cuts a filled chunk into complete lines. The tail of the previous chunk arrives in
+// pending; the line straddling the boundary is materialized in boundary (the one copy),
+// every other line is a view into the chunk, and the new tail leaves in pending.
+void splitChunkLines(const InputChunk &chunk, std::string &pending, std::string &boundary,
+                     std::vector<std::string_view> &lines){
+    lines.clear();
+    const char *data = chunk.bytes.data();
+    unsigned long long size = chunk.size;
+    const char *firstNewline = (const char *)memchr(data, '\n', size);
+    if (firstNewline == nullptr){
+        // No line ends here; the whole chunk joins the carried tail
+        pending.append(data, size);
+        return;
+    }
+    unsigned long long consumed = firstNewline - data + 1;
+    if (pending.empty()){
+        lines.push_back(std::string_view(data, firstNewline - data));
+    } else {
+        boundary = pending;
+        boundary.append(data, firstNewline - data);
+        pending.clear();
+        lines.push_back(boundary);
+    }
+    while (consumed < size){
+        const char *newline = (const char *)memchr(data + consumed, '\n', size - consumed);
+        if (newline == nullptr){
+            pending.assign(data + consumed, size - consumed);
+            return;
+        }
+        lines.push_back(std::string_view(data + consumed, newline - (data + consumed)));
+        consumed = newline - data + 1;
+    }
+}
+
+// A numbered batch of input lines, the unit of work handed to the pool
+struct LineBatch {
+    unsigned long long sequence;
+    std::vector<std::string> lines;
+};
+
+// A bounded queue between the reader and the workers. The bound keeps the reader from
+// racing ahead of the hashers and buffering the entire input in memory.
+class BatchQueue {
+public:
+    BatchQueue(unsigned int capacity) : capacity(capacity), closed(false) {}
+
+    void push(LineBatch &&batch){
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [&]{ return batches.size() < capacity; });
+        batches.push(std::move(batch));
+        notEmpty.notify_one();
+    }
+
+    // Returns false once the queue is closed and drained, which tells a worker to exit
+    bool pop(LineBatch &batch){
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [&]{ return !batches.empty() || closed; });
+        if (batches.empty()){
+            return false;
+        }
+        batch = std::move(batches.front());
+        batches.pop();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close(){
+        std::unique_lock<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+    }
+
+private:
+    std::queue<LineBatch> batches;
+    unsigned int capacity;
+    bool closed;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+};
+
+// Collects finished batches from the workers and prints them in input order. Whichever
+// worker delivers the batch the output is waiting on drains everything that is ready.
+class OrderedOutput {
+public:
+    OrderedOutput() : nextSequence(0) {}
+
+    // In the common case the batch arrives in order and is printed straight out of the
+    // worker's arena; only batches that overtake their predecessors get copied aside.
+    void deliver(unsigned long long sequence, const std::vector<std::array<unsigned int, 8>> &digests){
+        std::unique_lock<std::mutex> lock(mutex);
+        if (sequence == nextSequence){
+            for (const std::array<unsigned int, 8> &digest : digests){
+                printHash(digest);
+            }
+            ++nextSequence;
+        } else {
+            pending[sequence] = digests;
+        }
+        while (!pending.empty() && pending.begin()->first == nextSequence){
+            for (const std::array<unsigned int, 8> &digest : pending.begin()->second){
+                printHash(digest);
+            }
+            pending.erase(pending.begin());
+            ++nextSequence;
+        }
+    }
+
+private:
+    unsigned long long nextSequence;
+    std::map<unsigned long long, std::vector<std::array<unsigned int, 8>>> pending;
+    std::mutex mutex;
+};
+
+// Hashes stdin with a pool of jobs worker threads
+int runWithPool(int jobs){
+    BatchQueue queue(jobs * 4);
+    OrderedOutput output;
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < jobs; ++i){
+        workers.emplace_back([&]{
+            // Each worker owns one arena, reused for every batch it processes
+            BatchArena arena;
+            LineBatch batch;
+            std::vector<std::string_view> lineViews;
+            while (queue.pop(batch)){
+                lineViews.assign(batch.lines.begin(), batch.lines.end());
+                output.deliver(batch.sequence, hashLines(lineViews.data(), lineViews.size(), arena));
+            }
+        });
+    }
+
+    // The main thread drains the chunk reader; the batches own their lines as strings
+    // because the views' backing chunk is recycled as soon as the chunk is split
+    unsigned long long sequence = 0;
+    std::vector<std::string> lines;
+    {
+        ChunkReader reader;
+        std::string pending, boundary;
+        std::vector<std::string_view> chunkLines;
+        while (InputChunk *chunk = reader.next()){
+            splitChunkLines(*chunk, pending, boundary, chunkLines);
+            for (std::string_view line : chunkLines){
+                lines.emplace_back(line);
+                if (lines.size() == batchSize){
+                    queue.push({sequence++, std::move(lines)});
+                    lines.clear();
+                }
+            }
+            reader.recycle(chunk);
+        }
+        if (!pending.empty()){
+            lines.emplace_back(std::move(pending));
+        }
+    }
+    if (!lines.empty()){
+        queue.push({sequence++, std::move(lines)});
+    }
+    queue.close();
+
+    for (std::thread &worker : workers){
+        worker.join();
+    }
+    return 0;
+}
+
+/*
+ NUMA-aware sharded mode. On a dual-socket box one global pool bounces queue cache
+ lines and freshly decoded buffers across the socket interconnect. --numa builds one
+ queue + worker shard per NUMA node instead: workers are pinned to their node's CPUs,
+ so their arenas - where the decode and hash bandwidth actually goes - are first-touch
+ allocated node-locally, and batches are dealt round-robin across the shards. Output
+ order is a property of the whole input, so the ordered output stage stays shared; it
+ only trades one cache line per batch, not per line. With a single node (or no sysfs
+ topology) the mode quietly collapses into the ordinary pool.
+*/
+struct NumaNode {
+    std::vector<int> cpus;
+};
+
+// Parses sysfs cpulist syntax: "0-3,8-11,16"
+std::vector<int> parseCpuList(const std::string &text){
+    std::vector<int> cpus;
+    std::istringstream input(text);
+    std::string range;
+    while (std::getline(input, range, ',')){
+        int low, high;
+        unsigned long long dash = range.find('-');
+        if (!parseSmallInt(range.substr(0, dash).c_str(), low)){
+            continue;
+        }
+        high = low;
+        if (dash != std::string::npos && !parseSmallInt(range.substr(dash + 1).c_str(), high)){
+            continue;
+        }
+        for (int cpu = low; cpu <= high; ++cpu){
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// The nodes this machine exposes, in node order; empty when sysfs has no topology
+std::vector<NumaNode> discoverNumaNodes(){
+    std::vector<NumaNode> nodes;
+    for (int n = 0; ; ++n){
+        std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+        if (!cpulist){
+            break;
+        }
+        std::string text;
+        std::getline(cpulist, text);
+        NumaNode node;
+        node.cpus = parseCpuList(text);
+        if (!node.cpus.empty()){
+            nodes.push_back(std::move(node));
+        }
+    }
+    return nodes;
+}
+
+// Pins the calling thread onto the given CPUs
+void pinToCpus(const std::vector<int> &cpus){
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus){
+        CPU_SET(cpu, &set);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// The sharded pool over an explicit node list, with jobs threads split across shards
+int runShardedPool(const std::vector<NumaNode> &nodes, int jobs){
+    int shards = nodes.size();
+    int threadsPerShard = jobs / shards > 0 ? jobs / shards : 1;
+
+    std::vector<std::unique_ptr<BatchQueue>> queues;
+    for (int s = 0; s < shards; ++s){
+        queues.emplace_back(new BatchQueue(threadsPerShard * 4));
+    }
+    OrderedOutput output;
+
+    std::vector<std::thread> workers;
+    for (int s = 0; s < shards; ++s){
+        for (int t = 0; t < threadsPerShard; ++t){
+            workers.emplace_back([&, s]{
+                // Pin first, then allocate: the arena pages fault in on this node
+                pinToCpus(nodes[s].cpus);
+                BatchArena arena;
+                LineBatch batch;
+                std::vector<std::string_view> lineViews;
+                while (queues[s]->pop(batch)){
+                    lineViews.assign(batch.lines.begin(), batch.lines.end());
+                    output.deliver(batch.sequence, hashLines(lineViews.data(), lineViews.size(), arena));
+                }
+            });
+        }
+    }
+
+    // The reader deals batches round-robin: batch k goes to shard k % shards
+    unsigned long long sequence = 0;
+    std::vector<std::string> lines;
+    {
+        ChunkReader reader;
+        std::string pending, boundary;
+        std::vector<std::string_view> chunkLines;
+        while (InputChunk *chunk = reader.next()){
+            splitChunkLines(*chunk, pending, boundary, chunkLines);
+            for (std::string_view line : chunkLines){
+                lines.emplace_back(line);
+                if (lines.size() == batchSize){
+                    queues[sequence % shards]->push({sequence, std::move(lines)});
+                    ++sequence;
+                    lines.clear();
+                }
+            }
+            reader.recycle(chunk);
+        }
+        if (!pending.empty()){
+            lines.emplace_back(std::move(pending));
+        }
+    }
+    if (!lines.empty()){
+        queues[sequence % shards]->push({sequence, std::move(lines)});
+        ++sequence;
+    }
+    for (int s = 0; s < shards; ++s){
+        queues[s]->close();
+    }
+    for (std::thread &worker : workers){
+        worker.join();
+    }
+    return 0;
+}
+
+// --numa: one shard per node when the machine has more than one
+int runWithNumaPool(int jobs){
+    std::vector<NumaNode> nodes = discoverNumaNodes();
+    if (nodes.size() < 2){
+        return runWithPool(jobs);
+    }
+    return runShardedPool(nodes, jobs);
+}
+
+// Hashes stdin serially on the calling thread. The chunk reader still runs, so even
+// the single-threaded mode overlaps its input latency with hashing, and every line
+// within a chunk is hashed straight out of the read buffer.
+int runSerial(){
+    BatchArena arena;
+    ChunkReader reader;
+    std::string pending, boundary;
+    std::vector<std::string_view> lines;
+    while (InputChunk *chunk = reader.next()){
+        splitChunkLines(*chunk, pending, boundary, lines);
+        for (unsigned long long done = 0; done < lines.size(); done += batchSize){
+            unsigned long long n = lines.size() - done < (unsigned long long)batchSize ? lines.size() - done : batchSize;
+            for (const std::array<unsigned int, 8> &digest : hashLines(lines.data() + done, n, arena)){
+                printHash(digest);
+            }
+        }
+        reader.recycle(chunk);
+    }
+    if (!pending.empty()){
+        // Input without a final newline still ends in one last line
+        std::string_view last = pending;
+        for (const std::array<unsigned int, 8> &digest : hashLines(&last, 1, arena)){
+            printHash(digest);
+        }
+    }
+    return 0;
+}
+
+/*
+ Binary input mode. Producers that already hold raw bytes should not have to hex-encode
+ them (doubling pipe traffic) just so the line decoder can undo it. --binary reads
+ length-prefixed records - a 32-bit little-endian byte count followed by the raw
+ message - through a large read(2) buffer, and feeds the payload chunks straight into
+ the streaming context without any per-record allocation.
+*/
+
+// A buffered byte reader over stdin, refilled with large read(2) calls
+class BinaryReader {
+public:
+    BinaryReader() : buffer(1 << 22), position(0), filled(0) {}
+
+    // Copies exactly n bytes into out. Returns false at end of input; bytesRead tells
+    // the caller whether the record was cleanly absent (0) or cut off halfway.
+    bool readExact(unsigned char *out, unsigned long long n, unsigned long long &bytesRead){
+        bytesRead = 0;
+        while (bytesRead < n){
+            if (position == filled && !refill()){
+                return false;
+            }
+            unsigned long long chunk = filled - position;
+            if (chunk > n - bytesRead){
+                chunk = n - bytesRead;
+            }
+            memcpy(out + bytesRead, buffer.data() + position, chunk);
+            position += chunk;
+            bytesRead += chunk;
+        }
+        return true;
+    }
+
+    // Hashes exactly n bytes into the context straight from the read buffer
+    bool consumeInto(Sha256Context &context, unsigned long long n){
+        while (n > 0){
+            if (position == filled && !refill()){
+                return false;
+            }
+            unsigned long long chunk = filled - position;
+            if (chunk > n){
+                chunk = n;
+            }
+            context.update(buffer.data() + position, chunk);
+            position += chunk;
+            n -= chunk;
+        }
+        return true;
+    }
+
+private:
+    bool refill(){
+        long long got = read(0, buffer.data(), buffer.size());
+        if (got <= 0){
+            return false;
+        }
+        position = 0;
+        filled = got;
+        return true;
+    }
+
+    std::vector<unsigned char> buffer;
+    unsigned long long position;
+    unsigned long long filled;
+};
+
+// Hashes length-prefixed binary records from stdin until end of input
+int runBinary(){
+    BinaryReader reader;
+    Sha256Context context;
+    for (;;){
+        unsigned char prefix[4];
+        unsigned long long got;
+        if (!reader.readExact(prefix, 4, got)){
+            if (got != 0){
+                std::cerr << "sha256: truncated length prefix in binary input\n";
+                return 1;
+            }
+            return 0; // clean end of input
+        }
+        unsigned long long length = prefix[0] | (prefix[1] << 8) | (prefix[2] << 16) | ((unsigned long long)prefix[3] << 24);
+        if (hmacMode){
+            context = hmacKey.innerContext();
+        } else {
+            context.init();
+        }
+        if (!reader.consumeInto(context, length)){
+            std::cerr << "sha256: truncated record in binary input\n";
+            return 1;
+        }
+        printHash(hmacMode ? hmacKey.finish(context) : context.final());
+    }
+}
+
+/*
+ Tree hashing. SHA-256's block chaining makes one large message inherently serial, so a
+ 10 GB file can never use more than one core. --tree replaces the flat digest with a
+ binary Merkle tree over fixed 1 MiB leaves: leaf hashes are independent and run across
+ a thread pool, and only the small combine tree is serial. Leaves are domain-separated
+ from interior nodes by a prefix byte (0x00 leaf, 0x01 node), so a leaf digest can never
+ be replayed as a node. The result is deliberately not plain SHA-256 - both ends of a
+ protocol must opt in.
+*/
+const unsigned long long treeLeafSize = 1 << 20;
+
+// The digest of one leaf: a 0x00 prefix then the leaf's bytes
+std::array<unsigned int, 8> hashTreeLeaf(const unsigned char *data, unsigned long long length){
+    const unsigned char leafPrefix = 0x00;
+    Sha256Context context;
+    context.init();
+    context.update(&leafPrefix, 1);
+    context.update(data, length);
+    return context.final();
+}
+
+// The digest of an interior node: a 0x01 prefix then the two child digests
+std::array<unsigned int, 8> hashTreeNode(const std::array<unsigned int, 8> &left, const std::array<unsigned int, 8> &right){
+    const unsigned char nodePrefix = 0x01;
+    unsigned char children[64];
+    digestToBytes(left, children);
+    digestToBytes(right, children + 32);
+    Sha256Context context;
+    context.init();
+    context.update(&nodePrefix, 1);
+    context.update(children, 64);
+    return context.final();
+}
+
+// Tree-hashes an in-memory message, fanning the leaves out over jobs threads
+std::array<unsigned int, 8> treeHash(const unsigned char *data, unsigned long long length, int jobs){
+    unsigned long long leafCount = (length + treeLeafSize - 1) / treeLeafSize;
+    if (leafCount == 0){
+        leafCount = 1; // the empty message is one empty leaf
+    }
+    std::vector<std::array<unsigned int, 8>> level(leafCount);
+
+    // Leaf hashes are independent; stripe them across the workers
+    if (jobs > 1 && leafCount > 1){
+        std::vector<std::thread> workers;
+        for (int w = 0; w < jobs; ++w){
+            workers.emplace_back([&, w]{
+                for (unsigned long long i = w; i < leafCount; i += jobs){
+                    unsigned long long offset = i * treeLeafSize;
+                    unsigned long long n = length - offset < treeLeafSize ? length - offset : treeLeafSize;
+                    level[i] = hashTreeLeaf(data + offset, n);
+                }
+            });
+        }
+        for (std::thread &worker : workers){
+            worker.join();
+        }
+    } else {
+        for (unsigned long long i = 0; i < leafCount; ++i){
+            unsigned long long offset = i * treeLeafSize;
+            unsigned long long n = length - offset < treeLeafSize ? length - offset : treeLeafSize;
+            level[i] = hashTreeLeaf(data + offset, n);
+        }
+    }
+
+    // Combine pairwise up to the root; an unpaired node is carried up unchanged
+    while (level.size() > 1){
+        std::vector<std::array<unsigned int, 8>> next((level.size() + 1) / 2);
+        for (unsigned long long i = 0; i + 1 < level.size(); i += 2){
+            next[i / 2] = hashTreeNode(level[i], level[i + 1]);
+        }
+        if (level.size() % 2 == 1){
+            next.back() = level.back();
+        }
+        level = std::move(next);
+    }
+    return level[0];
+}
+
+/*
+ Persistent digest cache. CI trees are re-verified many times a day with almost nothing
+ changed in between, so --cache keeps a memory-mapped open-addressed table on disk
+ mapping a file's identity (device, inode, size, mtime) to its digest. A hit turns a
+ full re-hash into one stat call; any change to the file moves its mtime or size and
+ misses naturally. The table is fixed-size with short probe runs, and a full run simply
+ overwrites its oldest-looking victim - it is a cache, losing an entry only costs one
+ re-hash. --invalidate ignores stored entries but still refreshes them.
+*/
+
+// The identity of a file's contents as far as the cache is concerned
+struct CacheKey {
+    unsigned long long device;
+    unsigned long long inode;
+    unsigned long long size;
+    unsigned long long mtimeNanoseconds;
+};
+
+CacheKey cacheKeyFromStat(const struct stat &info){
+    CacheKey key;
+    key.device = info.st_dev;
+    key.inode = info.st_ino;
+    key.size = info.st_size;
+    key.mtimeNanoseconds = (unsigned long long)info.st_mtim.tv_sec * 1000000000ull + info.st_mtim.tv_nsec;
+    return key;
+}
+
+class DigestCache {
+public:
+    // Maps (creating if needed) the cache file. Returns false without disabling the
+    // run itself - a missing cache only costs the hashing it would have saved.
+    bool open(const std::string &path){
+        static const unsigned long long capacity = 1 << 16; // 4 MiB of entries
+        unsigned long long bytes = sizeof(Header) + capacity * sizeof(Entry);
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0){
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) < 0 || ((unsigned long long)info.st_size != bytes && ftruncate(fd, bytes) < 0)){
+            close(fd);
+            return false;
+        }
+        bool fresh = info.st_size == 0;
+        void *map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED){
+            return false;
+        }
+        header = (Header *)map;
+        entries = (Entry *)(header + 1);
+        if (fresh || header->magic != cacheMagic || header->capacity != capacity){
+            // New file, or an old layout: start the table over
+            memset(map, 0, bytes);
+            header->magic = cacheMagic;
+            header->capacity = capacity;
+        }
+        return true;
+    }
+
+    ~DigestCache(){
+        if (header != nullptr){
+            munmap(header, sizeof(Header) + header->capacity * sizeof(Entry));
+        }
+    }
+
+    // Looks the key up; on a hit the stored digest is copied out
+    bool lookup(const CacheKey &key, std::array<unsigned int, 8> &digest) const {
+        if (header == nullptr){
+            return false;
+        }
+        unsigned long long slot = mix(key) & (header->capacity - 1);
+        for (int probe = 0; probe < probeLength; ++probe){
+            const Entry &entry = entries[(slot + probe) & (header->capacity - 1)];
+            if (entry.key.device == key.device && entry.key.inode == key.inode &&
+                entry.key.size == key.size && entry.key.mtimeNanoseconds == key.mtimeNanoseconds &&
+                entry.checksum == entryChecksum(entry.key, entry.digest)){
+                memcpy(digest.data(), entry.digest, sizeof(entry.digest));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Stores or refreshes an entry; with the probe run full, the first slot is the victim
+    void store(const CacheKey &key, const std::array<unsigned int, 8> &digest){
+        if (header == nullptr){
+            return;
+        }
+        unsigned long long slot = mix(key) & (header->capacity - 1);
+        Entry *victim = &entries[slot];
+        for (int probe = 0; probe < probeLength; ++probe){
+            Entry &entry = entries[(slot + probe) & (header->capacity - 1)];
+            bool sameFile = entry.key.device == key.device && entry.key.inode == key.inode;
+            bool empty = entry.key.device == 0 && entry.key.inode == 0;
+            if (sameFile || empty){
+                victim = &entry;
+                break;
+            }
+        }
+        victim->key = key;
+        memcpy(victim->digest, digest.data(), sizeof(victim->digest));
+        victim->checksum = entryChecksum(victim->key, victim->digest);
+    }
+
+private:
+    struct Header {
+        unsigned long long magic;
+        unsigned long long capacity;
+    };
+    struct Entry {
+        CacheKey key;
+        unsigned int digest[8];
+        unsigned long long checksum;
+    };
+    static const unsigned long long cacheMagic = 0x5348413235364432ull; // "SHA256D2"
+    static const int probeLength = 8;
+
+    // splitmix64-style finalizer over the four key words
+    static unsigned long long mix(const CacheKey &key){
+        unsigned long long h = key.device * 0x9E3779B97F4A7C15ull;
+        for (unsigned long long word : {key.inode, key.size, key.mtimeNanoseconds}){
+            h ^= word;
+            h *= 0xBF58476D1CE4E5B9ull;
+            h ^= h >> 31;
+        }
+        return h;
+    }
+
+    // Binds a key to its digest against torn writes: the table is MAP_SHARED across
+    // concurrent runs with no locking, so a process dying (or racing) between the key
+    // and digest stores can leave an entry whose halves disagree. The checksum is
+    // written last and re-derived on lookup; a mismatch is just a miss.
+    static unsigned long long entryChecksum(const CacheKey &key, const unsigned int *digest){
+        unsigned long long h = mix(key);
+        for (int i = 0; i < 8; ++i){
+            h ^= digest[i];
+            h *= 0xBF58476D1CE4E5B9ull;
+            h ^= h >> 31;
+        }
+        return h;
+    }
+
+    Header *header = nullptr;
+    Entry *entries = nullptr;
+};
+
+// Opened by --cache; entries are ignored (but refreshed) under --invalidate
+DigestCache digestCache;
+bool cacheEnabled = false;
+bool invalidateCache = false;
+
+/*
+ File hashing mode. The file is mapped into memory and fed to the streaming context
+ in place, so the kernel reads its blocks straight out of the page cache: no hex
+ decode, no read() copies, no intermediate buffers. Only the final padded block is
+ synthesized, inside the context as usual.
+*/
+int hashFile(const std::string &path, bool tree, int jobs){
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        std::cerr << "sha256: cannot open " << path << "\n";
+        return 1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0){
+        std::cerr << "sha256: cannot stat " << path << "\n";
+        close(fd);
+        return 1;
+    }
+
+    // The cache holds plain SHA-256 digests only; HMAC and tree digests depend on more
+    // than the file's contents and must not share its key
+    bool cacheable = cacheEnabled && !hmacMode && !tree;
+    CacheKey cacheKey = cacheKeyFromStat(info);
+    std::array<unsigned int, 8> cached;
+    if (cacheable && !invalidateCache && digestCache.lookup(cacheKey, cached)){
+        printHash(cached);
+        close(fd);
+        return 0;
+    }
+
+    void *mapping = nullptr;
+    if (info.st_size > 0){
+        mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED){
+            std::cerr << "sha256: cannot mmap " << path << "\n";
+            close(fd);
+            return 1;
+        }
+        // We walk the file front to back exactly once, tell the kernel so
+        madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+    }
+
+    if (tree){
+        printHash(treeHash((const unsigned char *)mapping, info.st_size, jobs));
+    } else {
+        Sha256Context context;
+        if (hmacMode){
+            context = hmacKey.innerContext();
+        } else {
+            context.init();
+        }
+        if (info.st_size > 0){
+            context.update((const unsigned char *)mapping, info.st_size);
+        }
+        std::array<unsigned int, 8> digest = hmacMode ? hmacKey.finish(context) : context.final();
+        if (cacheable){
+            digestCache.store(cacheKey, digest);
+        }
+        printHash(digest);
+    }
+
+    if (mapping != nullptr){
+        munmap(mapping, info.st_size);
+    }
+    close(fd);
+    return 0;
+}
+
+/*
+ Batch file hashing. --files-from reads one path per line from a list file and emits
+ "<digest>  <path>" in list order. A synchronous open/read/hash loop over millions of
+ small files leaves an NVMe array mostly idle, so where liburing is available each
+ worker drives its own io_uring with several files' reads outstanding at once and
+ hashes each completion as it lands; the compression kernel becomes one stage of that
+ pipeline instead of the whole loop. Without liburing the workers fall back to plain
+ read() loops, which still overlaps the independent files across cores.
+*/
+
+// Hashes one file through the streaming context with a plain read loop. The fallback
+// path, and the error path when a ring submission fails.
+bool hashFileSync(const std::string &path, std::vector<unsigned char> &buffer, std::array<unsigned int, 8> &digest){
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        return false;
+    }
+    Sha256Context context;
+    if (hmacMode){
+        context = hmacKey.innerContext();
+    } else {
+        context.init();
+    }
+    buffer.resize(1 << 20);
+    long long got;
+    while ((got = read(fd, buffer.data(), buffer.size())) > 0){
+        context.update(buffer.data(), got);
+    }
+    close(fd);
+    if (got < 0){
+        return false;
+    }
+    digest = hmacMode ? hmacKey.finish(context) : context.final();
+    return true;
+}
+
+#ifdef SHA256_HAVE_URING
+// Hashes the stripe paths[begin], paths[begin+stride], ... with up to ringDepth files'
+// reads in flight on one io_uring. Each file keeps a single outstanding read; its
+// completion is hashed while the kernel works on the other files' reads.
+void hashFileStripeUring(const std::vector<std::string> &paths, unsigned long long begin,
+                         unsigned long long stride, std::vector<std::array<unsigned int, 8>> &digests,
+                         std::vector<char> &ok){
+    const int ringDepth = 8;
+    const unsigned long long chunkSize = 1 << 20;
+
+    struct InFlight {
+        int fd;
+        unsigned long long index;
+        unsigned long long offset;
+        Sha256Context context;
+        std::vector<unsigned char> buffer;
+    };
+
+    io_uring ring;
+    if (io_uring_queue_init(ringDepth, &ring, 0) < 0){
+        // No ring (old kernel, rlimit): degrade to the synchronous loop
+        std::vector<unsigned char> buffer;
+        for (unsigned long long i = begin; i < paths.size(); i += stride){
+            if (ok[i] != 2){
+                ok[i] = hashFileSync(paths[i], buffer, digests[i]);
+            }
+        }
+        return;
+    }
+
+    std::vector<InFlight> slots(ringDepth);
+    unsigned long long next = begin;
+    int active = 0;
+
+    // Opens the next file of the stripe into a free slot and submits its first read
+    auto fill = [&](InFlight &slot) -> bool {
+        while (next < paths.size()){
+            unsigned long long index = next;
+            next += stride;
+            if (ok[index] == 2){
+                continue; // already answered by the digest cache
+            }
+            int fd = open(paths[index].c_str(), O_RDONLY);
+            if (fd < 0){
+                ok[index] = 0;
+                continue;
+            }
+            slot.fd = fd;
+            slot.index = index;
+            slot.offset = 0;
+            if (hmacMode){
+                slot.context = hmacKey.innerContext();
+            } else {
+                slot.context.init();
+            }
+            slot.buffer.resize(chunkSize);
+            io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_read(sqe, fd, slot.buffer.data(), chunkSize, 0);
+            io_uring_sqe_set_data(sqe, &slot);
+            ++active;
+            return true;
+        }
+        return false;
+    };
+
+    for (InFlight &slot : slots){
+        if (!fill(slot)){
+            break;
+        }
+    }
+
+    while (active > 0){
+        io_uring_submit_and_wait(&ring, 1);
+        io_uring_cqe *cqe;
+        while (io_uring_peek_cqe(&ring, &cqe) == 0){
+            InFlight &slot = *(InFlight *)io_uring_cqe_get_data(cqe);
+            long long got = cqe->res;
+            io_uring_cqe_seen(&ring, cqe);
+            if (got > 0){
+                // Hash this chunk, then keep reading the same file
+                slot.context.update(slot.buffer.data(), got);
+                slot.offset += got;
+                io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+                io_uring_prep_read(sqe, slot.fd, slot.buffer.data(), chunkSize, slot.offset);
+                io_uring_sqe_set_data(sqe, &slot);
+            } else {
+                // End of file (or a read error); either way this slot is free again
+                close(slot.fd);
+                --active;
+                if (got == 0){
+                    digests[slot.index] = hmacMode ? hmacKey.finish(slot.context) : slot.context.final();
+                    ok[slot.index] = 1;
+                } else {
+                    ok[slot.index] = 0;
+                }
+                fill(slot);
+            }
+        }
+    }
+    io_uring_queue_exit(&ring);
+}
+#endif
+
+// Hashes every path in the list file across jobs workers and prints the results in
+// list order once all workers have joined
+int runFilesFrom(const std::string &listPath, int jobs){
+    std::vector<std::string> paths;
+    std::ifstream list(listPath);
+    if (!list){
+        std::cerr << "sha256: cannot read list file " << listPath << "\n";
+        return 1;
+    }
+    std::string line;
+    while (std::getline(list, line)){
+        if (!line.empty()){
+            paths.push_back(line);
+        }
+    }
+
+    std::vector<std::array<unsigned int, 8>> digests(paths.size());
+    std::vector<char> ok(paths.size(), 0);
+
+    // With the cache on, one stat per path settles most of the list before any worker
+    // opens a file. 2 marks a hit, so the post-pass below does not re-store it.
+    bool cacheable = cacheEnabled && !hmacMode;
+    std::vector<CacheKey> keys(cacheable ? paths.size() : 0);
+    if (cacheable){
+        for (unsigned long long i = 0; i < paths.size(); ++i){
+            struct stat info;
+            if (stat(paths[i].c_str(), &info) == 0){
+                keys[i] = cacheKeyFromStat(info);
+                if (!invalidateCache && digestCache.lookup(keys[i], digests[i])){
+                    ok[i] = 2;
+                }
+            }
+        }
+    }
+
+    int workers = jobs;
+    if ((unsigned long long)workers > paths.size()){
+        workers = paths.size() > 0 ? paths.size() : 1;
+    }
+    std::vector<std::thread> pool;
+    for (int w = 0; w < workers; ++w){
+        pool.emplace_back([&, w]{
+#ifdef SHA256_HAVE_URING
+            hashFileStripeUring(paths, w, workers, digests, ok);
+#else
+            std::vector<unsigned char> buffer;
+            for (unsigned long long i = w; i < paths.size(); i += workers){
+                if (ok[i] != 2){
+                    ok[i] = hashFileSync(paths[i], buffer, digests[i]);
+                }
+            }
+#endif
+        });
+    }
+    for (std::thread &worker : pool){
+        worker.join();
+    }
+
+    int status = 0;
+    for (unsigned long long i = 0; i < paths.size(); ++i){
+        if (cacheable && ok[i] == 1){
+            digestCache.store(keys[i], digests[i]);
+        }
+        if (ok[i]){
+            digestWriter.writeDigestWithPath(digests[i], paths[i]);
+        } else {
+            std::cerr << "sha256: cannot read " << paths[i] << "\n";
+            status = 1;
+        }
+    }
+    return status;
+}
+
+/*
+ Drivers for the non-256 family members, selected by --algo. They reuse the stdin hex
+ pipeline and the mmap file path but hash through the generic context; the SHA-256
+ specific fast paths (multi-buffer batches, the binary and HMAC modes) stay with the
+ default algorithm.
+*/
+template <typename Traits>
+int runSerialShaVariant(){
+    std::string line;
+    std::vector<unsigned char> message;
+    unsigned char digest[ShaContext<Traits>::digestBytes];
+    while (std::getline(std::cin, line)){
+        if (!decodeHex(line, message)){
+            std::cerr << "sha256: skipping invalid input line\n";
+            sawInvalidInput = true;
+            continue;
+        }
+        ShaContext<Traits> context;
+        context.init();
+        context.update(message.data(), message.size());
+        context.final(digest);
+        digestWriter.writeDigestBytes(digest, sizeof(digest));
+    }
+    return 0;
+}
+
+template <typename Traits>
+int hashFileShaVariant(const std::string &path){
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) < 0){
+        std::cerr << "sha256: cannot open " << path << "\n";
+        return 1;
+    }
+    ShaContext<Traits> context;
+    context.init();
+    if (info.st_size > 0){
+        void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED){
+            std::cerr << "sha256: cannot mmap " << path << "\n";
+            close(fd);
+            return 1;
+        }
+        madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+        context.update((const unsigned char *)mapping, info.st_size);
+        munmap(mapping, info.st_size);
+    }
+    close(fd);
+    unsigned char digest[ShaContext<Traits>::digestBytes];
+    context.final(digest);
+    digestWriter.writeDigestBytes(digest, sizeof(digest));
+    return 0;
+}
+
+/*
+ Verification mode. --check reads a manifest of "<digest>  <path>" lines (the format
+ --files-from emits, and sha256sum's), re-hashes every path across the worker pool and
+ compares with one 32-byte memcmp. Only failures are reported, one line each, plus a
+ summary on stderr; the exit status says whether everything matched. --fail-fast makes
+ the first failure abort the remaining work, so a mismatched multi-gigabyte artifact
+ does not hold up the answer.
+*/
+int runCheck(const std::string &manifestPath, int jobs, bool failFast){
+    std::ifstream manifest(manifestPath);
+    if (!manifest){
+        std::cerr << "sha256: cannot read manifest " << manifestPath << "\n";
+        return 1;
+    }
+    std::vector<std::string> paths;
+    std::vector<std::array<unsigned char, 32>> expected;
+    std::string line;
+    std::vector<unsigned char> digest;
+    while (std::getline(manifest, line)){
+        if (line.empty()){
+            continue;
+        }
+        unsigned long long space = line.find(' ');
+        if (space == std::string::npos || !decodeHex(std::string_view(line).substr(0, space), digest) || digest.size() != 32){
+            std::cerr << "sha256: malformed manifest line: " << line << "\n";
+            return 1;
+        }
+        unsigned long long pathStart = line.find_first_not_of(' ', space);
+        if (pathStart == std::string::npos){
+            std::cerr << "sha256: malformed manifest line: " << line << "\n";
+            return 1;
+        }
+        if (line[pathStart] == '*'){
+            ++pathStart; // sha256sum's binary-mode marker
+        }
+        paths.push_back(line.substr(pathStart));
+        expected.emplace_back();
+        memcpy(expected.back().data(), digest.data(), 32);
+    }
+
+    // 0 = pending, 1 = matched, 2 = mismatched, 3 = unreadable, 4 = skipped by fail-fast
+    std::vector<char> result(paths.size(), 0);
+    std::atomic<bool> abort(false);
+
+    int workers = jobs;
+    if ((unsigned long long)workers > paths.size()){
+        workers = paths.size() > 0 ? paths.size() : 1;
+    }
+    std::vector<std::thread> pool;
+    for (int w = 0; w < workers; ++w){
+        pool.emplace_back([&, w]{
+            std::vector<unsigned char> buffer;
+            for (unsigned long long i = w; i < paths.size(); i += workers){
+                if (abort.load(std::memory_order_relaxed)){
+                    result[i] = 4;
+                    continue;
+                }
+                std::array<unsigned int, 8> computed;
+                if (!hashFileSync(paths[i], buffer, computed)){
+                    result[i] = 3;
+                    continue;
+                }
+                unsigned char computedBytes[32];
+                digestToBytes(computed, computedBytes);
+                result[i] = memcmp(computedBytes, expected[i].data(), 32) == 0 ? 1 : 2;
+                if (result[i] != 1 && failFast){
+                    abort.store(true, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    for (std::thread &worker : pool){
+        worker.join();
+    }
+
+    unsigned long long failed = 0, unreadable = 0, skipped = 0;
+    for (unsigned long long i = 0; i < paths.size(); ++i){
+        if (result[i] == 2){
+            std::cout << paths[i] << ": FAILED\n";
+            ++failed;
+        } else if (result[i] == 3){
+            std::cout << paths[i] << ": FAILED open or read\n";
+            ++unreadable;
+        } else if (result[i] == 4){
+            ++skipped;
+        }
+    }
+    if (failed + unreadable > 0){
+        std::cerr << "sha256: " << failed + unreadable << " of " << paths.size() << " checks failed";
+        if (skipped > 0){
+            std::cerr << " (" << skipped << " skipped after the first failure)";
+        }
+        std::cerr << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// The benchmark harness includes this file to reach the kernels and stages directly
+// and provides its own entry point, so the CLI main can be compiled out.
+#ifndef SHA256_NO_MAIN
+int runMain(int argc, char *argv[]){
+    int jobs = 1;
+    bool binary = false;
+    bool tree = false;
+    std::string filesFrom;
+    std::string checkManifest;
+    bool failFast = false;
+    bool numa = false;
+    std::string algo = "sha256";
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i){
+        if (std::string(argv[i]) == "--jobs" && i + 1 < argc){
+            if (!parseSmallInt(argv[++i], jobs) || jobs < 1){
+                std::cerr << "sha256: invalid job count " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::string(argv[i]) == "--file" && i + 1 < argc){
+            files.push_back(argv[++i]);
+        } else if (std::string(argv[i]) == "--binary"){
+            binary = true;
+        } else if (std::string(argv[i]) == "--tree"){
+            tree = true;
+        } else if (std::string(argv[i]) == "--files-from" && i + 1 < argc){
+            filesFrom = argv[++i];
+        } else if (std::string(argv[i]) == "--check" && i + 1 < argc){
+            checkManifest = argv[++i];
+        } else if (std::string(argv[i]) == "--fail-fast"){
+            failFast = true;
+        } else if (std::string(argv[i]) == "--numa"){
+            numa = true;
+        } else if (std::string(argv[i]) == "--gpu"){
+#ifdef SHA256_HAVE_OPENCL
+            gpuMode = gpuEngine.init();
+            if (!gpuMode){
+                std::cerr << "sha256: no usable GPU, falling back to the CPU lanes\n";
+            }
+#else
+            std::cerr << "sha256: built without OpenCL, --gpu falls back to the CPU lanes\n";
+#endif
+        } else if (std::string(argv[i]) == "--stats"){
+            statsEnabled = true;
+#ifdef SHA256_STATS
+            signal(SIGUSR1, statsSignalHandler);
+#else
+            std::cerr << "sha256: built without SHA256_STATS, --stats has nothing to report\n";
+#endif
+        } else if (std::string(argv[i]) == "--cache" && i + 1 < argc){
+            cacheEnabled = digestCache.open(argv[++i]);
+            if (!cacheEnabled){
+                std::cerr << "sha256: cannot open cache " << argv[i] << ", hashing without it\n";
+            }
+        } else if (std::string(argv[i]) == "--invalidate"){
+            invalidateCache = true;
+        } else if (std::string(argv[i]) == "--algo" && i + 1 < argc){
+            algo = argv[++i];
+            if (algo != "sha256" && algo != "sha224" && algo != "sha384" && algo != "sha512"){
+                std::cerr << "sha256: unknown algorithm " << algo << "\n";
+                return 1;
+            }
+        } else if (std::string(argv[i]) == "--hmac" && i + 1 < argc){
+            // The key is the raw contents of the given file
+            int fd = open(argv[++i], O_RDONLY);
+            struct stat info;
+            if (fd < 0 || fstat(fd, &info) < 0){
+                std::cerr << "sha256: cannot read key file " << argv[i] << "\n";
+                return 1;
+            }
+            std::vector<unsigned char> key(info.st_size);
+            if (info.st_size > 0 && read(fd, key.data(), key.size()) != (long long)key.size()){
+                std::cerr << "sha256: cannot read key file " << argv[i] << "\n";
+                close(fd);
+                return 1;
+            }
+            close(fd);
+            hmacKey.setKey(key.data(), key.size());
+            hmacMode = true;
+        } else {
+            std::cerr << "usage: sha256 [--jobs N] [--numa] [--algo sha224|sha256|sha384|sha512] [--binary] [--tree] [--hmac KEYFILE] [--cache PATH [--invalidate]] [--files-from LIST] [--check MANIFEST [--fail-fast]] [--file PATH]...\n";
+            return 1;
+        }
+    }
+    if (algo != "sha256"){
+        // The binary, HMAC, tree and batch modes are built on the SHA-256 fast paths
+        if (binary || tree || hmacMode || !filesFrom.empty()){
+            std::cerr << "sha256: --algo " << algo << " supports only line and --file input\n";
+            return 1;
+        }
+        int status = 0;
+        if (!files.empty()){
+            for (const std::string &path : files){
+                status = algo == "sha224" ? hashFileShaVariant<Sha224Traits>(path)
+                       : algo == "sha384" ? hashFileShaVariant<Sha384Traits>(path)
+                       : hashFileShaVariant<Sha512Traits>(path);
+                if (status != 0){
+                    return status;
+                }
+            }
+            return 0;
+        }
+        status = algo == "sha224" ? runSerialShaVariant<Sha224Traits>()
+               : algo == "sha384" ? runSerialShaVariant<Sha384Traits>()
+               : runSerialShaVariant<Sha512Traits>();
+        return sawInvalidInput ? 1 : status;
+    }
+    if (binary){
+        return runBinary();
+    }
+    if (!filesFrom.empty()){
+        return runFilesFrom(filesFrom, jobs);
+    }
+    if (!checkManifest.empty()){
+        return runCheck(checkManifest, jobs, failFast);
+    }
+    if (!files.empty()){
+        for (const std::string &path : files){
+            int status = hashFile(path, tree, jobs);
+            if (status != 0){
+                return status;
+            }
+        }
+        return 0;
+    }
+    int status;
+    if (jobs > 1){
+        status = numa ? runWithNumaPool(jobs) : runWithPool(jobs);
+    } else {
+        status = runSerial();
+    }
+    if (sawInvalidInput){
+        return 1;
+    }
+    return status;
+}
+
+// The real work lives in runMain so the stats dump can run after every exit path,
+// once the worker threads have folded their counters into the totals
+int main(int argc, char *argv[]){
+    int status = runMain(argc, argv);
+#ifdef SHA256_STATS
+    if (statsEnabled){
+        digestWriter.flush();
+        statsCounters.fold();
+        statsDump();
+    }
+#endif
+    return status;
 }
+#endif // SHA256_NO_MAIN
@@ -0,0 +1,40 @@
+/*******************************************************************************************************
+  The stable C surface of the hasher, for services that link it in-process instead of
+  shelling out to the CLI. Plain C types only, so C++, Go (cgo) and Python (ctypes)
+  callers all bind against the same four symbols.
+
+  A stream is a caller-owned value type: no allocation, no destroy call, safe to copy
+  for midstate reuse. Digests always come back as 32 big-endian bytes.
+********************************************************************************************************/
+#ifndef SHA256_H
+#define SHA256_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Opaque storage for one streaming context; sized, aligned and checked against the
+   implementation at compile time */
+typedef struct sha256_stream {
+    unsigned long long opaque[16];
+} sha256_stream;
+
+/* Starts (or restarts) a stream */
+void sha256_init(sha256_stream *stream);
+
+/* Feeds the next length bytes of the message */
+void sha256_update(sha256_stream *stream, const void *data, unsigned long long length);
+
+/* Finishes the stream and writes the 32-byte digest */
+void sha256_final(sha256_stream *stream, unsigned char digest[32]);
+
+/* Hashes count independent messages through the multi-buffer engine; digests receives
+   count * 32 bytes, in message order */
+void sha256_batch(const unsigned char *const *messages, const unsigned long long *lengths,
+                  unsigned long long count, unsigned char *digests);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHA256_H */
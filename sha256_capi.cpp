@@ -0,0 +1,48 @@
+/*******************************************************************************************************
+  The library build of the hasher: the C API from sha256.h wrapped around the contexts
+  and kernels in sha256.cpp. Like the benchmark harness, this includes the
+  implementation directly with the CLI entry point compiled out, so the library and the
+  binary can never drift apart.
+
+  Build with "make lib" or the CMake sha256 library target.
+********************************************************************************************************/
+#define SHA256_NO_MAIN
+#include "sha256.cpp"
+
+#include "sha256.h"
+
+// The opaque stream bytes hold a real context; keep the promise in the header honest
+static_assert(sizeof(Sha256Context) <= sizeof(sha256_stream::opaque),
+              "sha256_stream::opaque is too small for Sha256Context");
+static_assert(alignof(Sha256Context) <= alignof(unsigned long long),
+              "sha256_stream is under-aligned for Sha256Context");
+
+extern "C" {
+
+void sha256_init(sha256_stream *stream){
+    Sha256Context *context = new (stream->opaque) Sha256Context;
+    context->init();
+}
+
+void sha256_update(sha256_stream *stream, const void *data, unsigned long long length){
+    ((Sha256Context *)stream->opaque)->update((const unsigned char *)data, length);
+}
+
+void sha256_final(sha256_stream *stream, unsigned char digest[32]){
+    digestToBytes(((Sha256Context *)stream->opaque)->final(), digest);
+}
+
+void sha256_batch(const unsigned char *const *messages, const unsigned long long *lengths,
+                  unsigned long long count, unsigned char *digests){
+    std::vector<MessageView> views(count);
+    std::vector<std::array<unsigned int, 8>> results(count);
+    for (unsigned long long i = 0; i < count; ++i){
+        views[i] = {messages[i], lengths[i]};
+    }
+    sha256Many(views.data(), results.data(), count);
+    for (unsigned long long i = 0; i < count; ++i){
+        digestToBytes(results[i], digests + i * 32);
+    }
+}
+
+} // extern "C"
@@ -0,0 +1,14 @@
+# Runs the CLI over the sample input and compares against the expected answers
+execute_process(COMMAND ${CLI}
+                INPUT_FILE ${SOURCE_DIR}/test/sample.in
+                OUTPUT_FILE ${CMAKE_BINARY_DIR}/sample.out
+                RESULT_VARIABLE status)
+if(NOT status EQUAL 0)
+  message(FATAL_ERROR "sha256 exited with ${status}")
+endif()
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files
+                ${CMAKE_BINARY_DIR}/sample.out ${SOURCE_DIR}/test/sample.ans
+                RESULT_VARIABLE differs)
+if(NOT differs EQUAL 0)
+  message(FATAL_ERROR "output differs from test/sample.ans")
+endif()